@@ -0,0 +1,667 @@
+# include <algorithm>
+# include <cmath>
+# include <cstring>
+# include <type_traits>
+# include "Game.hpp"
+# include "Profiler.hpp"
+
+namespace ColorMix
+{
+	namespace
+	{
+		template <class Type>
+		uint8* WriteArray(uint8* p, const std::vector<Type>& values)
+		{
+			if (not values.empty())
+			{
+				std::memcpy(p, values.data(), values.size() * sizeof(Type));
+			}
+
+			return p + values.size() * sizeof(Type);
+		}
+
+		// バイト列はアラインされていないので、resize してから memcpy で読む
+		template <class Type>
+		const uint8* ReadArray(const uint8* p, std::vector<Type>& values, size_t count)
+		{
+			values.resize(count);
+
+			if (count)
+			{
+				std::memcpy(values.data(), p, count * sizeof(Type));
+			}
+
+			return p + count * sizeof(Type);
+		}
+	}
+
+	// snapshot() の固定長部分。optional は has フラグと値に分ける
+	template <class MixRules>
+	struct BasicGame<MixRules>::SnapshotHeader
+	{
+		Board board;
+		GameRandom random;
+		Waves waves;
+
+		double enemySpeed;
+		double stageProgress;
+		double prevStageProgress;
+		double waitNodeSetTime;
+		double pickingUnderLimitY;
+		double time;
+		Vec2 predictedPos;
+
+		int32 enemySetIndexY;
+		int32 progressIndex;
+		int32 prevLaneIndex;
+		int32 score;
+
+		ColorType waitingNode;
+		PickedNode pickingNode;
+		bool hasWaitingNode;
+		bool hasPickingNode;
+		bool hasPickingUnderLimitY;
+
+		uint32 laneSizes[gridSize.x];
+		uint32 poperSizes[gridSize.x];
+		uint32 nextNodeCount;
+		uint32 stackCount;
+	};
+
+	namespace
+	{
+		// 敵の行の乱数の seed は、ゲームの seed とずらす
+		constexpr uint64 WaveSeedSalt = 0x5741564553ull;
+	}
+
+	template <class MixRules>
+	BasicGame<MixRules>::BasicGame(uint64 seed, const Difficulty& difficulty)
+		: difficulty{ difficulty }
+	{
+		// 毎 tick 使う領域はここで確保しておき、以降は init() をまたいでも使い回す
+		nodesLanes.resize(gridSize.x);
+		for (auto& lane : nodesLanes)
+		{
+			lane.reserve(laneNodeCapacity);
+		}
+		nodePopers.resize(gridSize.x);
+		for (auto& lane : nodePopers)
+		{
+			lane.reserve(lanePoperCapacity);
+		}
+		nextNodes.resize(3);
+		shuffledNodeStack.reserve(difficulty.nodeSet.size());
+		events.reserve(gridSize.x * 4);
+		m_emptiedCells.reserve(gridSize.x * gridSize.y);
+		init(seed);
+	}
+
+	template <class MixRules>
+	void BasicGame<MixRules>::init(uint64 seed)
+	{
+		random.seed(seed);
+		board.clear();
+		// レーンの中身だけを空にして、確保済みの領域は次のゲームで使い回す
+		nodesLanes.resize(gridSize.x);
+		for (auto& lane : nodesLanes)
+		{
+			lane.clear();
+		}
+		nodePopers.resize(gridSize.x);
+		for (auto& lane : nodePopers)
+		{
+			lane.clear();
+		}
+		time = 0.0;
+		waitNodeSetTime = time;
+		waitingNode.reset();
+		shuffledNodeStack.clear();
+		for (auto& node : nextNodes)
+		{
+			// 袋の中身が nextNodes より少なくても引けるように、空になったら詰め直す
+			if (shuffledNodeStack.empty())
+			{
+				shuffledNodeStack = difficulty.nodeSet;
+				random.shuffle(shuffledNodeStack);
+			}
+
+			node = shuffledNodeStack.back();
+			shuffledNodeStack.pop_back();
+		}
+		enemySpeed = difficulty.firstEnemySpeed;
+		stageProgress = startEnemySetIndexY * enemySpanLength;
+		prevStageProgress = stageProgress;
+		enemySetIndexY = startEnemySetIndexY;
+		progressIndex = 0;
+
+		uint32 nodeColors = 0;
+		for (ColorType type : difficulty.nodeSet)
+		{
+			nodeColors |= uint32{ 1 } << static_cast<int32>(type);
+		}
+		waves.init(seed ^ WaveSeedSalt, difficulty.wavePattern, Mixing::Closure(nodeColors));
+		waves.refill(difficulty.waveScript);
+
+		score = 0;
+		pickingNode.reset();
+		pickingUnderLimitY.reset();
+		events.clear();
+		cascade = {};
+		m_emptiedCells.clear();
+	}
+
+	template <class MixRules>
+	bool BasicGame<MixRules>::isGameOver() const
+	{
+		COLORMIX_PROFILE_SCOPE(gameOver);
+		// 下の行ほど y が大きいので、全レーンで一番下の行だけを見ればよい
+		const int32 y_i = board.lowestOccupiedRow();
+		return (y_i != -1) and (fixedNodeCenterYReal(y_i) > laneHeight + enemySpanLength / 2);
+	}
+
+	template <class MixRules>
+	int32 BasicGame<MixRules>::nodeIndexAtY(double y) const
+	{
+		return static_cast<int32>(std::floor((stageProgress - y) / enemySpanLength));
+	}
+
+	template <class MixRules>
+	void BasicGame<MixRules>::progressGrid() {
+		progressIndex++;
+		board.scroll();
+	}
+
+	template <class MixRules>
+	void BasicGame<MixRules>::tellGridBecomeEmpty(const Point& index) {
+		m_emptiedCells.push_back(index);
+	}
+
+	template <class MixRules>
+	void BasicGame<MixRules>::resolveCascade()
+	{
+		COLORMIX_PROFILE_SCOPE(cascade);
+		// 解放は固定ノードを消すだけなので、どの順に解決しても結果は同じ
+		for (const Point& index : m_emptiedCells)
+		{
+			int32 depth = 0;
+
+			for (Point downIndex = index - Point{ 0, 1 }; board.inBounds(downIndex) and board.hasFixed(downIndex); downIndex.y--)
+			{
+				addNode(index.x, fixedNodeCenterYReal(downIndex.y), board.fixedType(downIndex), board.fixedWasEnemy(downIndex));
+				board.clearFixed(downIndex);
+				++depth;
+			}
+
+			cascade.chainDepth = std::max(cascade.chainDepth, depth);
+			cascade.released += depth;
+			cascade.cellsTouched += depth + 1;
+		}
+
+		m_emptiedCells.clear();
+	}
+
+	template <class MixRules>
+	void BasicGame<MixRules>::addNode(size_t laneIndex, double y, ColorType type, int32 wasEnemy)
+	{
+		// レーンは常に y の昇順 (上から下) に並べておく
+		auto& lane = nodesLanes[laneIndex];
+		const auto it = std::upper_bound(lane.begin(), lane.end(), y, [](double y, const ColorNode& node) { return y < node.y; });
+		lane.insert(it, { y, type, wasEnemy, false, false, time, y });
+	}
+
+	template <class MixRules>
+	void BasicGame<MixRules>::moveLaneNodes(std::vector<ColorNode>& lane, double delta, double upperLimitY) const
+	{
+		if (lane.empty())
+		{
+			return;
+		}
+
+		for (auto& node : lane)
+		{
+			node.y -= delta * difficulty.nodeSpeed;
+		}
+
+		// 隣り合うノードの重なりを半分ずつ押し戻す
+		for (size_t i = 1; i < lane.size(); ++i)
+		{
+			const double over = enemySpanLength - (lane[i].y - lane[i - 1].y);
+			if (0 < over)
+			{
+				lane[i - 1].y -= over / 2;
+				lane[i].y += over / 2;
+			}
+		}
+
+		// 上限より上には行かせず、押し戻しで残った重なりは下側のノードをずらして解消する
+		lane.front().y = std::max(lane.front().y, upperLimitY);
+
+		for (size_t i = 1; i < lane.size(); ++i)
+		{
+			lane[i].y = std::max(lane[i].y, lane[i - 1].y + enemySpanLength);
+		}
+	}
+
+	template <class MixRules>
+	void BasicGame<MixRules>::spawnEnemies()
+	{
+		COLORMIX_PROFILE_SCOPE(spawn);
+		while (nodeIndexAtY(enemyAppearY) >= enemySetIndexY)
+		{
+			const typename Waves::Row row = waves.pop(difficulty.waveScript);
+			const int32 y = enemySetIndexY - progressIndex;
+
+			for (int32 x = 0; x < gridSize.x; ++x)
+			{
+				if (((row.occupied >> x) & 1) and board.inBounds({ x, y }))
+				{
+					board.setEnemy({ x, y }, row.colors[x]);
+				}
+			}
+
+			enemySetIndexY++;
+		}
+	}
+
+	template <class MixRules>
+	void BasicGame<MixRules>::update(double delta, const TickInput& input)
+	{
+		events.clear();
+		cascade = {};
+
+		// 補間の起点を残す。同じ tick の 2 つ目以降の入力 (delta が 0) では動かないので、前のものを残しておく
+		if (0 < delta)
+		{
+			prevStageProgress = stageProgress;
+
+			for (int32 lane_i = 0; lane_i < gridSize.x; ++lane_i)
+			{
+				for (auto& node : nodesLanes[lane_i])
+				{
+					node.prevY = node.y;
+				}
+
+				for (auto& p : nodePopers[lane_i])
+				{
+					p.prevY = p.y;
+				}
+			}
+		}
+
+		time += delta;
+
+		enemySpeed += delta * difficulty.enemySpeedRamp;
+
+		stageProgress += delta * enemySpeed;
+
+		while (static_cast<int32>(stageProgress / enemySpanLength) - startEnemySetIndexY > progressIndex)
+		{
+			progressGrid();
+		}
+
+
+		const double upperLimit = upperLimitY();
+
+		for (int32 lane_i = 0; lane_i < gridSize.x; ++lane_i)
+		{
+			auto& lane = nodesLanes[lane_i];
+
+			{
+				COLORMIX_PROFILE_SCOPE(lanePhysics);
+				moveLaneNodes(lane, delta, upperLimit);
+			}
+
+			COLORMIX_PROFILE_SCOPE(collision);
+
+			for (auto& node : lane)
+			{
+				//find collision
+				Point findIndex = { lane_i,nodeIndexAtYReal(node.y - enemySpanLength / 2) };
+				const bool found = board.inBounds(findIndex) and board.isOccupied(findIndex);
+
+				if (found)
+				{
+					Point pushIndex = findIndex + Point{ 0, -1 };
+					node.y = fixedNodeCenterYReal(pushIndex.y);
+					node.beFixed = true;
+					if (board.inBounds(pushIndex)) {
+						board.setFixed(pushIndex, node.type, node.wasEnemy);
+
+						//find around
+						bool foundAround = false;
+						for (Point rp : {Point{0, 1}, Point{ 1,0 }, Point{ 0,-1 }, Point{ -1,0 }}) {
+							Point aroundIndex = pushIndex + rp;
+							if (board.inBounds(aroundIndex)) {
+								const typename Board::Bits row = typename Board::Bits{ 1 } << aroundIndex.y;
+								if (board.enemyBits(aroundIndex.x) & row)
+								{
+									if (board.enemyBits(aroundIndex.x, node.type) & row)
+									{
+										board.clearEnemy(aroundIndex);
+										tellGridBecomeEmpty(aroundIndex);
+										nodePopers[aroundIndex.x].push_back({ fixedNodeCenterYReal(aroundIndex.y) ,node.type, 0, 0, fixedNodeCenterYReal(aroundIndex.y) });
+										score += 1;
+										events.push_back({ GameEventType::broke, aroundIndex.x, fixedNodeCenterYReal(aroundIndex.y) });
+										foundAround = true;
+									}
+								}
+								else if (board.fixedBits(aroundIndex.x, node.type) & row)
+								{
+									score += board.fixedWasEnemy(aroundIndex);
+									board.clearFixed(aroundIndex);
+									tellGridBecomeEmpty(aroundIndex);
+									events.push_back({ GameEventType::pop, aroundIndex.x, fixedNodeCenterYReal(aroundIndex.y) });
+									foundAround = true;
+								}
+							}
+						}
+						if (foundAround) {
+							score += board.fixedWasEnemy(pushIndex);
+							board.clearFixed(pushIndex);
+							tellGridBecomeEmpty(pushIndex);
+						}
+					}
+
+
+				}
+			}
+
+			std::erase_if(lane, [](const ColorNode& node) {return node.beFixed; });
+		}
+
+		for (int32 lane_i = 0; lane_i < gridSize.x; ++lane_i)
+		{
+			COLORMIX_PROFILE_SCOPE(popers);
+			auto& popers = nodePopers[lane_i];
+
+			for (auto& p : popers)
+			{
+				int32 preN = nodeIndexAtYReal(p.y);
+				p.y += delta * (enemySpeed + p.speed);
+				p.speed += delta * 1500;
+				int32 postN = nodeIndexAtYReal(p.y);
+
+				for (int32 i = preN; i > postN; i--)
+				{
+					Point findIndex = { lane_i,i };
+					if (board.inBounds(findIndex)) {
+						if (board.hasEnemy(findIndex))
+						{
+							addNode(lane_i, fixedNodeCenterYReal(i), board.enemyType(findIndex), 1);
+							p.count++;
+							events.push_back({ GameEventType::pop, lane_i, fixedNodeCenterYReal(i), p.count });
+							board.clearEnemy(findIndex);
+							tellGridBecomeEmpty(findIndex);
+						}
+					}
+				}
+			}
+
+			// 一番下の行より下に抜けたポッパーはもう何にも当たらない
+			std::erase_if(popers, [this](const NodePoper& p) { return nodeIndexAtYReal(p.y) < 0; });
+		}
+
+		// 衝突とポッパーで空いたマスの下をまとめて解放する
+		resolveCascade();
+
+		spawnEnemies();
+
+		COLORMIX_PROFILE_SCOPE(input);
+
+		const Vec2 cursor = input.cursor;
+
+		const double dx = cursor.x - pickWaitingPos.x;
+		const double dy = cursor.y - pickWaitingPos.y;
+		if (not pickingNode and waitingNode and input.pressed and (dx * dx + dy * dy) <= waitingNodeRadius * waitingNodeRadius)
+		{
+			pickingNode = PickedNode{ *waitingNode };
+			waitingNode.reset();
+			waitNodeSetTime = time;
+
+			events.push_back({ GameEventType::pick, gridSize.x / 2, pickWaitingPos.y });
+		}
+
+		if (not pickingNode) {
+			bool picked = false;
+			size_t laneIndex = static_cast<size_t>(Clamp<int32>(static_cast<int32>(cursor.x / oneLaneWidth), 0, gridSize.x - 1));
+			for (auto& node : nodesLanes[laneIndex])
+			{
+				if (std::abs(node.y - cursor.y) < 20 and input.pressed)
+				{
+					pickingNode = PickedNode{ node.type,node.wasEnemy };
+					node.bePicked = true;
+					pickingUnderLimitY = node.y - stageProgress;
+					picked = true;
+					events.push_back({ GameEventType::pick, static_cast<int32>(laneIndex), node.y });
+					break;
+				}
+			}
+			if (picked) {
+				std::erase_if(nodesLanes[laneIndex], [](const ColorNode& node) {return node.bePicked; });
+			}
+		}
+
+		if (time - waitNodeSetTime > 0.1 and not waitingNode) {
+			if (not nextNodes.empty()) {
+				waitingNode = nextNodes[0];
+				nextNodes.erase(nextNodes.begin());
+
+				if (shuffledNodeStack.empty()) {
+					shuffledNodeStack = difficulty.nodeSet;
+					random.shuffle(shuffledNodeStack);
+				}
+
+				nextNodes.push_back(shuffledNodeStack.back());
+				shuffledNodeStack.pop_back();
+			}
+			else {
+				waitingNode = ColorType(random.range(0, 2));
+			}
+		}
+
+		if (pickingNode) {
+			// 混ぜる相手はカーソルの真下のレーンから探す
+			const int32 minedLaneIndex = Clamp<int32>(static_cast<int32>(cursor.x / oneLaneWidth), 0, gridSize.x - 1);
+
+			const double cursorY = dragCursorY(cursor.y);
+
+			bool mixable = false;
+			size_t minedIndex = 0;
+			ColorType mixedColor{};
+			for (size_t i = 0; i < nodesLanes[minedLaneIndex].size(); ++i)
+			{
+				const auto& node = nodesLanes[minedLaneIndex][i];
+				if (std::abs(node.y - cursorY) < enemySpanLength * 0.8)
+				{
+					if (auto mixed = Mixing::Get(node.type, pickingNode->type))
+					{
+						mixable = true;
+						minedIndex = i;
+						mixedColor = *mixed;
+
+						break;
+					}
+				}
+			}
+
+			const DropPrediction drop = predictDrop(cursor);
+			const int32 laneIndex = drop.lane;
+			predictedPos = drop.pos;
+			prevLaneIndex = laneIndex;
+
+
+			if (input.released)
+			{
+				if (mixable) {
+					ColorNode& mixedNode = nodesLanes[minedLaneIndex][minedIndex];
+					mixedNode.type = mixedColor;
+					mixedNode.wasEnemy += pickingNode->wasEnemy;
+					mixedNode.monyuStartTime = time;
+					events.push_back({ GameEventType::mix, minedLaneIndex, mixedNode.y });
+					pickingNode.reset();
+					pickingUnderLimitY.reset();
+				}
+				else {
+					addNode(laneIndex, predictedPos.y, pickingNode->type, pickingNode->wasEnemy);
+					pickingNode.reset();
+					pickingUnderLimitY.reset();
+					events.push_back({ GameEventType::drop, laneIndex, predictedPos.y });
+				}
+			}
+		}
+	}
+
+	template <class MixRules>
+	double BasicGame<MixRules>::dragCursorY(double y) const
+	{
+		const double upperLimit = upperLimitY();
+		double cursorY = Clamp(y, upperLimit, laneHeight);
+
+		if (pickingUnderLimitY) {
+			cursorY = Clamp(cursorY, upperLimit, *pickingUnderLimitY + stageProgress);
+		}
+
+		return cursorY;
+	}
+
+	template <class MixRules>
+	typename BasicGame<MixRules>::DropPrediction BasicGame<MixRules>::predictDrop(const Vec2& cursor) const
+	{
+		int32 laneIndex = Clamp<int32>(static_cast<int32>(cursor.x / oneLaneWidth), 0, gridSize.x - 1);
+
+		const double cursorY = dragCursorY(cursor.y);
+
+		const Vec2 prevPredictedPos = predictedPos;
+
+		Point centerIndex = { laneIndex,nodeIndexAtYReal(cursorY) };
+		if (board.inBounds(centerIndex)) {
+			if (board.isOccupied(centerIndex)) {
+
+				bool canShift = false;
+				Point shiftedIndex = { laneIndex,nodeIndexAtYReal(prevPredictedPos.y) };
+				if (board.inBounds(shiftedIndex)) {
+					if (not board.isOccupied(shiftedIndex)) {
+						canShift = true;
+					}
+				}
+				if (not canShift)laneIndex = prevLaneIndex;
+			}
+		}
+
+		Vec2 pos = Vec2{ laneIndex * oneLaneWidth + oneLaneWidth / 2, cursorY };
+
+		bool collision = false;
+		Point headIndex = { laneIndex,nodeIndexAtYReal(cursorY - enemySpanLength / 2) };
+		if (board.inBounds(headIndex)) {
+			if (board.isOccupied(headIndex)) {
+				collision = true;
+			}
+		}
+
+		if (collision) {
+			//find down empty grid
+			headIndex.y = board.firstFreeAtOrBelow(headIndex.x, headIndex.y - 1);
+			pos = Vec2{ headIndex.x * oneLaneWidth + oneLaneWidth / 2, fixedNodeCenterYReal(headIndex.y) };
+		}
+
+		return{ laneIndex, pos };
+	}
+
+	template <class MixRules>
+	void BasicGame<MixRules>::snapshot(GameSnapshot& out) const
+	{
+		static_assert(std::is_trivially_copyable_v<SnapshotHeader>);
+		static_assert(std::is_trivially_copyable_v<ColorNode> and std::is_trivially_copyable_v<NodePoper>);
+
+		SnapshotHeader header;
+		header.board = board;
+		header.random = random;
+		header.waves = waves;
+		header.enemySpeed = enemySpeed;
+		header.stageProgress = stageProgress;
+		header.prevStageProgress = prevStageProgress;
+		header.waitNodeSetTime = waitNodeSetTime;
+		header.pickingUnderLimitY = pickingUnderLimitY.value_or(0.0);
+		header.time = time;
+		header.predictedPos = predictedPos;
+		header.enemySetIndexY = enemySetIndexY;
+		header.progressIndex = progressIndex;
+		header.prevLaneIndex = prevLaneIndex;
+		header.score = score;
+		header.waitingNode = waitingNode.value_or(ColorType::red);
+		header.pickingNode = pickingNode.value_or(PickedNode{ ColorType::red });
+		header.hasWaitingNode = waitingNode.has_value();
+		header.hasPickingNode = pickingNode.has_value();
+		header.hasPickingUnderLimitY = pickingUnderLimitY.has_value();
+		header.nextNodeCount = static_cast<uint32>(nextNodes.size());
+		header.stackCount = static_cast<uint32>(shuffledNodeStack.size());
+
+		size_t size = sizeof(SnapshotHeader) + (nextNodes.size() + shuffledNodeStack.size()) * sizeof(ColorType);
+
+		for (int32 x = 0; x < gridSize.x; ++x)
+		{
+			header.laneSizes[x] = static_cast<uint32>(nodesLanes[x].size());
+			header.poperSizes[x] = static_cast<uint32>(nodePopers[x].size());
+			size += nodesLanes[x].size() * sizeof(ColorNode) + nodePopers[x].size() * sizeof(NodePoper);
+		}
+
+		out.bytes.resize(size);
+		uint8* p = out.bytes.data();
+		std::memcpy(p, &header, sizeof(SnapshotHeader));
+		p += sizeof(SnapshotHeader);
+
+		for (int32 x = 0; x < gridSize.x; ++x)
+		{
+			p = WriteArray(p, nodesLanes[x]);
+			p = WriteArray(p, nodePopers[x]);
+		}
+
+		p = WriteArray(p, nextNodes);
+		WriteArray(p, shuffledNodeStack);
+	}
+
+	template <class MixRules>
+	void BasicGame<MixRules>::restore(const GameSnapshot& in)
+	{
+		SnapshotHeader header;
+		std::memcpy(&header, in.bytes.data(), sizeof(SnapshotHeader));
+		const uint8* p = in.bytes.data() + sizeof(SnapshotHeader);
+
+		board = header.board;
+		random = header.random;
+		waves = header.waves;
+		enemySpeed = header.enemySpeed;
+		stageProgress = header.stageProgress;
+		prevStageProgress = header.prevStageProgress;
+		waitNodeSetTime = header.waitNodeSetTime;
+		time = header.time;
+		predictedPos = header.predictedPos;
+		enemySetIndexY = header.enemySetIndexY;
+		progressIndex = header.progressIndex;
+		prevLaneIndex = header.prevLaneIndex;
+		score = header.score;
+		waitingNode = header.hasWaitingNode ? std::optional{ header.waitingNode } : std::nullopt;
+		pickingNode = header.hasPickingNode ? std::optional{ header.pickingNode } : std::nullopt;
+		pickingUnderLimitY = header.hasPickingUnderLimitY ? std::optional{ header.pickingUnderLimitY } : std::nullopt;
+
+		nodesLanes.resize(gridSize.x);
+		nodePopers.resize(gridSize.x);
+
+		for (int32 x = 0; x < gridSize.x; ++x)
+		{
+			p = ReadArray(p, nodesLanes[x], header.laneSizes[x]);
+			p = ReadArray(p, nodePopers[x], header.poperSizes[x]);
+		}
+
+		p = ReadArray(p, nextNodes, header.nextNodeCount);
+		ReadArray(p, shuffledNodeStack, header.stackCount);
+
+		events.clear();
+		cascade = {};
+		m_emptiedCells.clear();
+	}
+
+	template struct BasicGame<StandardMixRules>;
+	template struct BasicGame<CMYMixRules>;
+	template struct BasicGame<ExtraTierMixRules>;
+}
@@ -0,0 +1,927 @@
+# pragma once
+# include <algorithm>
+# include <array>
+# include <bit>
+# include <cstddef>
+# include <cstdint>
+# include <optional>
+# include <span>
+# include <utility>
+# include <vector>
+
+// ウィンドウ・オーディオ・時計に依存しないゲームロジック本体
+// Siv3D 版 (Main.cpp) とネイティブのヘッドレスビルドの両方から使う
+namespace ColorMix
+{
+	using int32 = std::int32_t;
+	using uint8 = std::uint8_t;
+	using uint32 = std::uint32_t;
+	using uint64 = std::uint64_t;
+
+	struct Point
+	{
+		int32 x = 0;
+		int32 y = 0;
+
+		constexpr Point operator +(const Point& other) const { return{ x + other.x, y + other.y }; }
+		constexpr Point operator -(const Point& other) const { return{ x - other.x, y - other.y }; }
+		constexpr bool operator ==(const Point& other) const = default;
+	};
+
+	struct Vec2
+	{
+		double x = 0.0;
+		double y = 0.0;
+	};
+
+	template <class Type>
+	constexpr Type Clamp(Type v, Type min, Type max)
+	{
+		return (v < min) ? min : ((max < v) ? max : v);
+	}
+
+	// SplitMix64
+	// 標準ライブラリの分布はプラットフォームごとに結果が異なるため自前で実装する
+	class GameRandom
+	{
+	public:
+
+		explicit GameRandom(uint64 seed = 0)
+			: m_state{ seed } {}
+
+		void seed(uint64 seed) { m_state = seed; }
+
+		uint64 next()
+		{
+			uint64 z = (m_state += 0x9E3779B97F4A7C15ull);
+			z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+			z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+			return z ^ (z >> 31);
+		}
+
+		// [min, max]
+		int32 range(int32 min, int32 max)
+		{
+			return min + static_cast<int32>(next() % static_cast<uint64>(max - min + 1));
+		}
+
+		// std::vector でも std::array でもよい
+		template <class Container>
+		void shuffle(Container& values)
+		{
+			for (size_t i = values.size(); i > 1; --i)
+			{
+				std::swap(values[i - 1], values[static_cast<size_t>(next() % i)]);
+			}
+		}
+
+	private:
+
+		uint64 m_state;
+	};
+
+	enum class ColorType
+	{
+		red,
+		yellow,
+		blue,
+		orange,
+		green,
+		purple,
+		black,
+	};
+
+	inline constexpr int32 ColorTypeCount = 7;
+
+	struct MixRule
+	{
+		ColorType a;
+		ColorType b;
+		ColorType result;
+	};
+
+	// 混色ルールのセット
+	// Rules: 混ぜられる組み合わせ (順不同)
+	// Palette: 各 ColorType の表示色 (0xRRGGBB)
+
+	// 赤・黄・青
+	struct StandardMixRules
+	{
+		static constexpr MixRule Rules[] = {
+			{ ColorType::red, ColorType::yellow, ColorType::orange },
+			{ ColorType::red, ColorType::blue, ColorType::purple },
+			{ ColorType::yellow, ColorType::blue, ColorType::green },
+			{ ColorType::red, ColorType::green, ColorType::black },
+			{ ColorType::yellow, ColorType::purple, ColorType::black },
+			{ ColorType::blue, ColorType::orange, ColorType::black },
+		};
+
+		static constexpr uint32 Palette[ColorTypeCount] = { 0xFF0000, 0xFFFF00, 0x0000FF, 0xFFA500, 0x008000, 0x800080, 0x000000 };
+	};
+
+	//Real three color
+	// 混ぜ方は同じで、シアン・マゼンタ・イエローの減法混色で表示する
+	struct CMYMixRules : StandardMixRules
+	{
+		static constexpr uint32 Palette[ColorTypeCount] = { 0xFF00FF, 0xFFFF00, 0x00FFFF, 0xFF0000, 0x008000, 0x0000FF, 0x000000 };
+	};
+
+	// 二次色どうしも混ぜて黒にできる
+	struct ExtraTierMixRules : StandardMixRules
+	{
+		static constexpr MixRule Rules[] = {
+			{ ColorType::red, ColorType::yellow, ColorType::orange },
+			{ ColorType::red, ColorType::blue, ColorType::purple },
+			{ ColorType::yellow, ColorType::blue, ColorType::green },
+			{ ColorType::red, ColorType::green, ColorType::black },
+			{ ColorType::yellow, ColorType::purple, ColorType::black },
+			{ ColorType::blue, ColorType::orange, ColorType::black },
+			{ ColorType::orange, ColorType::green, ColorType::black },
+			{ ColorType::green, ColorType::purple, ColorType::black },
+			{ ColorType::purple, ColorType::orange, ColorType::black },
+		};
+	};
+
+	namespace detail
+	{
+		inline constexpr uint8 NoMix = 0xFF;
+
+		template <class MixRules>
+		constexpr std::array<uint8, ColorTypeCount * ColorTypeCount> MakeMixTable()
+		{
+			std::array<uint8, ColorTypeCount * ColorTypeCount> table{};
+			table.fill(NoMix);
+
+			for (const auto& rule : MixRules::Rules)
+			{
+				const size_t a = static_cast<size_t>(rule.a);
+				const size_t b = static_cast<size_t>(rule.b);
+
+				if ((table[a * ColorTypeCount + b] != NoMix) and (table[a * ColorTypeCount + b] != static_cast<uint8>(rule.result)))
+				{
+					throw "conflicting mix rules";
+				}
+
+				table[a * ColorTypeCount + b] = static_cast<uint8>(rule.result);
+				table[b * ColorTypeCount + a] = static_cast<uint8>(rule.result);
+			}
+
+			return table;
+		}
+
+		// 1 つのノードに混ざりうる元の数の最大値 (= wasEnemy の最大値)
+		template <class MixRules>
+		constexpr int32 MaxIngredients()
+		{
+			std::array<int32, ColorTypeCount> ingredients{};
+			ingredients.fill(1);
+
+			// ルールが循環していなければ色の数だけ繰り返せば収束する
+			for (int32 i = 0; i < ColorTypeCount; ++i)
+			{
+				for (const auto& rule : MixRules::Rules)
+				{
+					auto& count = ingredients[static_cast<size_t>(rule.result)];
+					count = std::max(count, ingredients[static_cast<size_t>(rule.a)] + ingredients[static_cast<size_t>(rule.b)]);
+				}
+			}
+
+			int32 result = 0;
+
+			for (int32 count : ingredients)
+			{
+				result = std::max(result, count);
+			}
+
+			return result;
+		}
+	}
+
+	// 混色ルールからコンパイル時に作る 7x7 の表
+	template <class MixRules>
+	struct MixTable
+	{
+		static constexpr std::array<uint8, ColorTypeCount * ColorTypeCount> Table = detail::MakeMixTable<MixRules>();
+
+		static constexpr int32 MaxWasEnemy = detail::MaxIngredients<MixRules>();
+
+		static constexpr int32 WasEnemyBits = std::bit_width(static_cast<uint32>(MaxWasEnemy));
+
+		// colors (ビット ColorType) に、そこから混ぜて作れる色をすべて足したもの
+		static constexpr uint32 Closure(uint32 colors)
+		{
+			// 1 回で 1 段ずつ増えるので、色の数だけ繰り返せば収束する
+			for (int32 i = 0; i < ColorTypeCount; ++i)
+			{
+				for (size_t a = 0; a < ColorTypeCount; ++a)
+				{
+					for (size_t b = 0; b < ColorTypeCount; ++b)
+					{
+						const uint8 mixed = Table[a * ColorTypeCount + b];
+
+						if (((colors >> a) & 1) and ((colors >> b) & 1) and (mixed != detail::NoMix))
+						{
+							colors |= uint32{ 1 } << mixed;
+						}
+					}
+				}
+			}
+
+			return colors;
+		}
+
+		static constexpr std::optional<ColorType> Get(ColorType a, ColorType b)
+		{
+			const uint8 mixed = Table[static_cast<size_t>(a) * ColorTypeCount + static_cast<size_t>(b)];
+
+			if (mixed == detail::NoMix)
+			{
+				return std::nullopt;
+			}
+
+			return ColorType(mixed);
+		}
+	};
+
+	template <class MixRules = StandardMixRules>
+	constexpr std::optional<ColorType> getMixedColor(ColorType a, ColorType b)
+	{
+		return MixTable<MixRules>::Get(a, b);
+	}
+
+	// 固定ノードと敵の盤面
+	// レーンごとに「行 y がビット y」のビット列で持つ。占有ビット・3 ビットの色プレーン・wasEnemy のプレーンを
+	// 固定ノードと敵で別々に持ち、盤面全体でも 200 バイトほどに収まる (ヒープ確保なし、トリビアルコピー可能)
+	// wasEnemy のプレーン数は混色ルールから決まる (MixTable::WasEnemyBits)
+	template <int32 Width, int32 Height, int32 WasEnemyBits>
+	class BitBoard
+	{
+	public:
+
+		using Bits = uint32;
+
+		static_assert(Height <= 32, "BitBoard rows must fit in Bits");
+
+		static constexpr int32 ColorBits = 3;
+
+		static constexpr Bits AllRows = (Height == 32) ? ~Bits{ 0 } : ((Bits{ 1 } << Height) - 1);
+
+		static constexpr int32 width() { return Width; }
+
+		static constexpr int32 height() { return Height; }
+
+		static constexpr Point size() { return{ Width, Height }; }
+
+		static constexpr bool inBounds(const Point& p)
+		{
+			return (0 <= p.x) and (p.x < Width) and (0 <= p.y) and (p.y < Height);
+		}
+
+		void clear()
+		{
+			m_lanes = {};
+			m_occupiedRows = 0;
+		}
+
+		Bits enemyBits(int32 lane) const { return m_lanes[lane].enemy.occupied; }
+
+		Bits fixedBits(int32 lane) const { return m_lanes[lane].fixed.occupied; }
+
+		Bits occupiedBits(int32 lane) const { return m_lanes[lane].enemy.occupied | m_lanes[lane].fixed.occupied; }
+
+		// どれかのレーンで埋まっている行。全レーンを見ずに済むよう、マスを埋める・空ける・scroll() のたびに更新しておく
+		Bits occupiedRows() const { return m_occupiedRows; }
+
+		// 色が type の敵がいる行
+		Bits enemyBits(int32 lane, ColorType type) const { return ColorMask(m_lanes[lane].enemy, type); }
+
+		// 色が type の固定ノードがある行
+		Bits fixedBits(int32 lane, ColorType type) const { return ColorMask(m_lanes[lane].fixed, type); }
+
+		bool hasEnemy(const Point& p) const { return (enemyBits(p.x) >> p.y) & 1; }
+
+		bool hasFixed(const Point& p) const { return (fixedBits(p.x) >> p.y) & 1; }
+
+		bool isOccupied(const Point& p) const { return (occupiedBits(p.x) >> p.y) & 1; }
+
+		ColorType enemyType(const Point& p) const { return ColorAt(m_lanes[p.x].enemy, p.y); }
+
+		ColorType fixedType(const Point& p) const { return ColorAt(m_lanes[p.x].fixed, p.y); }
+
+		int32 fixedWasEnemy(const Point& p) const
+		{
+			int32 wasEnemy = 0;
+
+			for (int32 i = 0; i < WasEnemyBits; ++i)
+			{
+				wasEnemy |= ((m_lanes[p.x].wasEnemy[i] >> p.y) & 1) << i;
+			}
+
+			return wasEnemy;
+		}
+
+		void setEnemy(const Point& p, ColorType type)
+		{
+			Set(m_lanes[p.x].enemy, p.y, type);
+			m_occupiedRows |= Bit(p.y);
+		}
+
+		void setFixed(const Point& p, ColorType type, int32 wasEnemy)
+		{
+			Lane& lane = m_lanes[p.x];
+			Set(lane.fixed, p.y, type);
+			m_occupiedRows |= Bit(p.y);
+
+			for (int32 i = 0; i < WasEnemyBits; ++i)
+			{
+				lane.wasEnemy[i] = (lane.wasEnemy[i] & ~Bit(p.y)) | (static_cast<Bits>((wasEnemy >> i) & 1) << p.y);
+			}
+		}
+
+		void clearEnemy(const Point& p)
+		{
+			m_lanes[p.x].enemy.occupied &= ~Bit(p.y);
+			refreshRow(p.y);
+		}
+
+		void clearFixed(const Point& p)
+		{
+			m_lanes[p.x].fixed.occupied &= ~Bit(p.y);
+			refreshRow(p.y);
+		}
+
+		// 行 0 を捨てて全体を 1 行下げ、一番上に空の行を入れる
+		void scroll()
+		{
+			m_occupiedRows >>= 1;
+
+			for (auto& lane : m_lanes)
+			{
+				lane.enemy.occupied >>= 1;
+				lane.fixed.occupied >>= 1;
+
+				for (int32 i = 0; i < ColorBits; ++i)
+				{
+					lane.enemy.color[i] >>= 1;
+					lane.fixed.color[i] >>= 1;
+				}
+
+				for (auto& bits : lane.wasEnemy)
+				{
+					bits >>= 1;
+				}
+			}
+		}
+
+		// 一番下 (y が最小) の埋まっている行。空のレーンなら -1
+		int32 lowestOccupied(int32 lane) const
+		{
+			const Bits bits = occupiedBits(lane);
+			return bits ? std::countr_zero(bits) : -1;
+		}
+
+		// 全レーンを通して一番下の埋まっている行。盤面が空なら -1
+		int32 lowestOccupiedRow() const
+		{
+			return m_occupiedRows ? std::countr_zero(m_occupiedRows) : -1;
+		}
+
+		// 行 y とそれより下で最初の空いている行。なければ -1
+		int32 firstFreeAtOrBelow(int32 lane, int32 y) const
+		{
+			if (y < 0)
+			{
+				return -1;
+			}
+
+			const Bits below = (Height <= y + 1) ? AllRows : ((Bits{ 1 } << (y + 1)) - 1);
+			const Bits free = ~occupiedBits(lane) & below;
+			return static_cast<int32>(std::bit_width(free)) - 1;
+		}
+
+	private:
+
+		struct Layer
+		{
+			Bits occupied = 0;
+
+			Bits color[ColorBits] = {};
+		};
+
+		struct Lane
+		{
+			Layer enemy;
+
+			Layer fixed;
+
+			Bits wasEnemy[WasEnemyBits] = {};
+		};
+
+		std::array<Lane, Width> m_lanes{};
+
+		// occupiedRows()
+		Bits m_occupiedRows = 0;
+
+		static constexpr Bits Bit(int32 y) { return Bits{ 1 } << y; }
+
+		// 行 y が空いたかもしれないときに、その行だけ全レーンを見直す
+		void refreshRow(int32 y)
+		{
+			const bool occupied = std::any_of(m_lanes.begin(), m_lanes.end(),
+				[bit = Bit(y)](const Lane& lane) { return ((lane.enemy.occupied | lane.fixed.occupied) & bit) != 0; });
+
+			m_occupiedRows = occupied ? (m_occupiedRows | Bit(y)) : (m_occupiedRows & ~Bit(y));
+		}
+
+		static Bits ColorMask(const Layer& layer, ColorType type)
+		{
+			Bits mask = layer.occupied;
+
+			for (int32 i = 0; i < ColorBits; ++i)
+			{
+				mask &= ((static_cast<int32>(type) >> i) & 1) ? layer.color[i] : ~layer.color[i];
+			}
+
+			return mask;
+		}
+
+		static ColorType ColorAt(const Layer& layer, int32 y)
+		{
+			int32 type = 0;
+
+			for (int32 i = 0; i < ColorBits; ++i)
+			{
+				type |= ((layer.color[i] >> y) & 1) << i;
+			}
+
+			return ColorType(type);
+		}
+
+		static void Set(Layer& layer, int32 y, ColorType type)
+		{
+			layer.occupied |= Bit(y);
+
+			for (int32 i = 0; i < ColorBits; ++i)
+			{
+				layer.color[i] = (layer.color[i] & ~Bit(y)) | (static_cast<Bits>((static_cast<int32>(type) >> i) & 1) << y);
+			}
+		}
+	};
+
+	// 敵の行の並べ方
+	enum class WavePattern : uint8
+	{
+		// どのマスも、使える色から一様に選ぶ
+		uniform,
+
+		// 使える色を 2 つずつ入れた袋から引く。短い間で見ても色が偏らない
+		balanced,
+
+		// Difficulty::waveScript の行を上から順に出し、尽きたら uniform で続ける
+		scripted,
+	};
+
+	// 1 行分の敵
+	template <int32 Width>
+	struct EnemyRow
+	{
+		// 敵がいる列 (ビット x)
+		uint32 occupied = 0;
+
+		std::array<ColorType, Width> colors{};
+	};
+
+	// これから出る敵の行を、seed から先回りして作っておくリングバッファ
+	// 残りが Capacity / 2 以下になったら、空いた分をまとめて作る。ゲームとは別の乱数を使うので、いつ作ってもゲームの流れは変わらない
+	// 作る行は使える色 (ノードの袋から混ぜて作れる色) だけで並べるので、どの敵も消せる。台本の行は使えない色を含んでいれば捨てる
+	// ヒープ確保なし、トリビアルコピー可能
+	template <int32 Width, int32 Capacity>
+	class EnemyWaves
+	{
+	public:
+
+		using Row = EnemyRow<Width>;
+
+		static constexpr uint32 AllColumns = (uint32{ 1 } << Width) - 1;
+
+		// reachable: 使える色 (ビット ColorType)。空なら全部の色
+		void init(uint64 seed, WavePattern pattern, uint32 reachable)
+		{
+			m_random.seed(seed);
+			m_pattern = pattern;
+			m_reachable = reachable ? reachable : ((uint32{ 1 } << ColorTypeCount) - 1);
+			m_paletteSize = 0;
+
+			for (int32 i = 0; i < ColorTypeCount; ++i)
+			{
+				if ((m_reachable >> i) & 1)
+				{
+					m_palette[m_paletteSize++] = ColorType(i);
+				}
+			}
+
+			m_head = 0;
+			m_count = 0;
+			m_bagCount = 0;
+			m_scriptRow = 0;
+			m_rejectedRows = 0;
+		}
+
+		// 空いているところをすべて埋める
+		void refill(std::span<const ColorType> script)
+		{
+			for (; m_count < Capacity; ++m_count)
+			{
+				m_rows[(m_head + m_count) % Capacity] = generate(script);
+			}
+		}
+
+		// 次の行を取り出す。script は init() してから同じものを渡す
+		Row pop(std::span<const ColorType> script)
+		{
+			if (m_count <= Capacity / 2)
+			{
+				refill(script);
+			}
+
+			const Row row = m_rows[m_head];
+			m_head = (m_head + 1) % Capacity;
+			--m_count;
+			return row;
+		}
+
+		// 作ってある行の数
+		int32 size() const
+		{
+			return m_count;
+		}
+
+		// i 番目に出る行 (0 が次)。i < size()
+		const Row& peek(int32 i) const
+		{
+			return m_rows[(m_head + i) % Capacity];
+		}
+
+		// 使えない色を含んでいて捨てた台本の行の数
+		int32 rejectedRows() const
+		{
+			return m_rejectedRows;
+		}
+
+		// どの敵も使える色か
+		static bool IsSolvable(const Row& row, uint32 reachable)
+		{
+			for (int32 x = 0; x < Width; ++x)
+			{
+				if (((row.occupied >> x) & 1) and (not ((reachable >> static_cast<int32>(row.colors[x])) & 1)))
+				{
+					return false;
+				}
+			}
+
+			return true;
+		}
+
+	private:
+
+		std::array<Row, Capacity> m_rows{};
+
+		GameRandom m_random;
+
+		std::array<ColorType, ColorTypeCount> m_palette{};
+
+		// balanced の袋
+		std::array<ColorType, ColorTypeCount * 2> m_bag{};
+
+		uint32 m_reachable = 0;
+
+		int32 m_paletteSize = 0;
+
+		int32 m_bagCount = 0;
+
+		// 次に出す行の位置と、作ってある行の数
+		int32 m_head = 0;
+
+		int32 m_count = 0;
+
+		// 次に読む台本の行
+		int32 m_scriptRow = 0;
+
+		int32 m_rejectedRows = 0;
+
+		WavePattern m_pattern = WavePattern::uniform;
+
+		Row generate(std::span<const ColorType> script)
+		{
+			Row row;
+
+			if (m_pattern == WavePattern::scripted)
+			{
+				while ((static_cast<size_t>(m_scriptRow) + 1) * Width <= script.size())
+				{
+					row.occupied = AllColumns;
+					std::copy_n(script.begin() + static_cast<size_t>(m_scriptRow) * Width, Width, row.colors.begin());
+					++m_scriptRow;
+
+					if (IsSolvable(row, m_reachable))
+					{
+						return row;
+					}
+
+					++m_rejectedRows;
+				}
+			}
+
+			row.occupied = AllColumns;
+
+			for (auto& color : row.colors)
+			{
+				color = (m_pattern == WavePattern::balanced) ? drawFromBag() : m_palette[m_random.range(0, m_paletteSize - 1)];
+			}
+
+			return row;
+		}
+
+		ColorType drawFromBag()
+		{
+			if (m_bagCount == 0)
+			{
+				for (int32 i = 0; i < m_paletteSize * 2; ++i)
+				{
+					m_bag[i] = m_palette[i % m_paletteSize];
+				}
+
+				m_bagCount = m_paletteSize * 2;
+				std::span<ColorType> bag = std::span{ m_bag }.first(m_bagCount);
+				m_random.shuffle(bag);
+			}
+
+			return m_bag[--m_bagCount];
+		}
+	};
+
+	struct ColorNode
+	{
+		double y;
+		ColorType type;
+		int32 wasEnemy = 0;
+		bool beFixed = false;
+		bool bePicked = false;
+		// もにゅっとするアニメーションの開始時刻 (Game::time)
+		double monyuStartTime = 0.0;
+		// 前の update() の前の y。描画の補間に使う
+		double prevY = 0.0;
+	};
+
+	struct PickedNode
+	{
+		ColorType type;
+		int32 wasEnemy = 0;
+	};
+
+	struct NodePoper {
+		double y;
+		ColorType type;
+		double speed = 0;
+		int32 count = 0;
+		// 前の update() の前の y。描画の補間に使う
+		double prevY = 0.0;
+	};
+
+	// 1 tick 分の入力 (盤面ローカル座標)
+	struct TickInput
+	{
+		Vec2 cursor;
+		// 左ボタンが押された瞬間
+		bool pressed = false;
+		// 左ボタンが離された瞬間
+		bool released = false;
+	};
+
+	enum class GameEventType
+	{
+		mix,
+		pop,
+		broke,
+		drop,
+		pick,
+	};
+
+	// update() 中に起きた出来事。音やエフェクトは呼び出し側がこれを見て鳴らす
+	struct GameEvent
+	{
+		GameEventType type;
+		int32 lane = 0;
+		double y = 0.0;
+		// ポッパーに押し出された pop の順番 (1 始まり)。それ以外は 0
+		int32 chain = 0;
+	};
+
+	// 1 回の update() で起きた連鎖 (固定ノードの解放) のまとめ
+	struct CascadeStats
+	{
+		// 1 つの空きマスから続けて解放された固定ノードの最大数
+		int32 chainDepth = 0;
+
+		// 解放された固定ノードの数
+		int32 released = 0;
+
+		// 解決中に調べたマスの数
+		int32 cellsTouched = 0;
+	};
+
+	// 難しさを決める値。BasicGame のコンストラクタに渡すか、init() の前に difficulty を書き換える
+	struct Difficulty
+	{
+		// 敵が降りてくる最初の速さ
+		double firstEnemySpeed = 4.0;
+
+		// 敵の速さの 1 秒あたりの増え方
+		double enemySpeedRamp = 0.02;
+
+		// ノードが上っていく速さ
+		double nodeSpeed = 20.0;
+
+		// 待機ノードを引く袋の中身
+		std::vector<ColorType> nodeSet = { ColorType::red,ColorType::yellow,ColorType::blue,ColorType::red,ColorType::yellow,ColorType::blue };
+
+		// 敵の行の並べ方
+		WavePattern wavePattern = WavePattern::uniform;
+
+		// WavePattern::scripted で出す行。1 行 gridSize.x 個ずつ、左の列から並べる
+		std::vector<ColorType> waveScript;
+	};
+
+	// BasicGame::snapshot() の書き出し先
+	// 固定長のヘッダ (盤面・乱数・スカラー値) のあとに、レーンのノード・ポッパー・袋の中身を続けて詰めたバイト列
+	// 同じものを使い回せば、2 回目からは確保が起きない
+	struct GameSnapshot
+	{
+		std::vector<uint8> bytes;
+	};
+
+	// MixRules で混色ルールを選ぶ (StandardMixRules, CMYMixRules, ExtraTierMixRules)
+	template <class MixRules>
+	struct BasicGame
+	{
+		using Rules = MixRules;
+
+		using Mixing = MixTable<MixRules>;
+
+		// 各レーンは y の昇順に並んでいる
+		std::vector<std::vector<ColorNode>> nodesLanes;
+		std::vector<std::vector<NodePoper>> nodePopers;
+
+
+		static constexpr double width = 360.0;
+		static constexpr double laneHeight = 500.0;
+		static constexpr double enemySpanLength = 65;
+		static constexpr Point gridSize = { 5,static_cast<int32>(laneHeight / enemySpanLength * 2) };
+		static constexpr double oneLaneWidth = width / gridSize.x;
+		static constexpr int32 startEnemySetIndexY = static_cast<int32>(laneHeight / enemySpanLength * 1.5);
+		// 起動時に確保しておくレーン 1 本あたりのノード数とポッパー数。越えたときだけ伸ばす
+		static constexpr int32 laneNodeCapacity = gridSize.y * 4;
+		static constexpr int32 lanePoperCapacity = gridSize.y;
+		// 先回りして作っておく敵の行の数
+		static constexpr int32 waveLookahead = 16;
+		Difficulty difficulty;
+		double enemySpeed = difficulty.firstEnemySpeed;
+
+		using Board = BitBoard<gridSize.x, gridSize.y, Mixing::WasEnemyBits>;
+		Board board;
+
+
+		double stageProgress = startEnemySetIndexY * enemySpanLength;
+		// 前の update() の前の stageProgress。描画の補間に使う
+		double prevStageProgress = stageProgress;
+		int32 enemySetIndexY = startEnemySetIndexY;
+		static constexpr double enemyAppearY = -enemySpanLength * 2;
+
+		using Waves = EnemyWaves<gridSize.x, waveLookahead>;
+		// これから出る敵の行。spawnEnemies() はここから取り出して並べるだけ
+		Waves waves;
+		int32 progressIndex = 0;
+
+
+		static constexpr Vec2 pickWaitingPos = Vec2{ width / 2, 510 };
+		std::optional<ColorType> waitingNode;
+		std::vector<ColorType> nextNodes;
+		double waitNodeSetTime = 0.0;
+
+		static constexpr double waitingNodeRadius = oneLaneWidth * 0.45;
+
+		std::vector<ColorType> shuffledNodeStack;
+
+		std::optional<PickedNode> pickingNode;
+		Vec2 predictedPos;
+		std::optional<double> pickingUnderLimitY;
+		int32 prevLaneIndex = 0;
+
+
+		int32 score = 0;
+
+		// update() に渡された delta の累積 [秒]
+		double time = 0.0;
+
+		GameRandom random;
+
+		// 直前の update() で起きたイベント
+		std::vector<GameEvent> events;
+
+		// 直前の update() の連鎖
+		CascadeStats cascade;
+
+
+		explicit BasicGame(uint64 seed = 0, const Difficulty& difficulty = {});
+
+		void init(uint64 seed);
+
+		bool isGameOver() const;
+
+		double laneCenterX(size_t laneIndex) const
+		{
+			return laneIndex * oneLaneWidth + oneLaneWidth / 2;
+		}
+
+		double fixedNodeCenterY(int32 n) const
+		{
+			return -enemySpanLength * n - enemySpanLength / 2 + stageProgress;
+		}
+
+		int32 nodeIndexAtY(double y) const;
+
+		int32 nodeIndexAtYReal(double y) const
+		{
+			return nodeIndexAtY(y) - progressIndex;
+		}
+
+		double fixedNodeCenterYReal(int32 n) const
+		{
+			return fixedNodeCenterY(n + progressIndex);
+		}
+
+		// ノードが上っていける一番上の y (画面の一番上の行のすぐ下)
+		double upperLimitY() const
+		{
+			return fixedNodeCenterYReal(nodeIndexAtYReal(0)) + enemySpanLength;
+		}
+
+		double nodeRadius() const
+		{
+			return oneLaneWidth * 0.4;
+		}
+
+		void progressGrid();
+
+		// index が空いたことを知らせる。その下に続く固定ノードは resolveCascade() でまとめて解放する
+		void tellGridBecomeEmpty(const Point& index);
+
+		// 知らされた空きマスの下の固定ノードを解放する。再帰せず、作業リストは使い回す
+		void resolveCascade();
+
+		// 画面上端より上に来た行に、waves から取り出した敵を並べる
+		void spawnEnemies();
+
+		void update(double delta, const TickInput& input);
+
+		struct DropPrediction
+		{
+			int32 lane = 0;
+
+			Vec2 pos;
+		};
+
+		// 拾っているノードを cursor の位置で離したときに入るレーンと位置。状態は変えない
+		// update() が predictedPos を決めるのに使うほか、描く直前の最新のカーソルでプレビューを出すのにも使える
+		DropPrediction predictDrop(const Vec2& cursor) const;
+
+		// ゲームを続きから進めるのに要る状態をすべて書き出す。コストは盤面とノードの数に比例する
+		// difficulty (設定) と events, cascade (直前の update() の結果) は含めない
+		void snapshot(GameSnapshot& out) const;
+
+		// snapshot() で書き出した状態に戻す。同じ MixRules の BasicGame が書き出したものに限る
+		void restore(const GameSnapshot& in);
+
+	private:
+
+		struct SnapshotHeader;
+
+		void addNode(size_t laneIndex, double y, ColorType type, int32 wasEnemy);
+
+		// ドラッグ中のカーソルの y を、ノードを置ける範囲に収める
+		double dragCursorY(double y) const;
+
+		// レーン内のノードを上に動かし、間隔を保つように押し戻す。レーンが y の昇順であることを前提に 1 回の走査で済ませる
+		// upperLimitY は upperLimitY() を tick ごとに 1 回だけ求めて渡す
+		void moveLaneNodes(std::vector<ColorNode>& lane, double delta, double upperLimitY) const;
+
+		// resolveCascade() の作業リスト
+		std::vector<Point> m_emptiedCells;
+	};
+
+	using Game = BasicGame<StandardMixRules>;
+
+	extern template struct BasicGame<StandardMixRules>;
+	extern template struct BasicGame<CMYMixRules>;
+	extern template struct BasicGame<ExtraTierMixRules>;
+}
@@ -0,0 +1,89 @@
+# pragma once
+# include <algorithm>
+# include <cmath>
+# include "Game.hpp"
+
+namespace ColorMix
+{
+	// ゲームを進める固定の刻み [秒]。Web 版もボット・チューナーのシミュレーションもこの刻みで update() する
+	inline constexpr double TickDelta = 1.0 / 120;
+
+	// ゲームの時間の進み方を決める時計
+	// 実時間の delta を毎フレーム 1 回だけ受け取り、一時停止・スロー・早送りの倍率を掛けたゲーム時間の delta にする
+	// 返した delta を Game::update() に渡すので、その累積の Game::time がアニメーションの基準になり、記録 (Replay) にもそのまま残る
+	class GameClock
+	{
+	public:
+
+		static constexpr double MinTimeScale = 0.125;
+
+		static constexpr double MaxTimeScale = 4.0;
+
+		// 実時間の realDelta 秒の間に進むゲーム時間 [秒]。一時停止中は 0
+		double gameDelta(double realDelta) const
+		{
+			return m_paused ? 0.0 : realDelta * m_timeScale;
+		}
+
+		bool isPaused() const { return m_paused; }
+
+		void setPaused(bool paused) { m_paused = paused; }
+
+		void togglePaused() { m_paused = (not m_paused); }
+
+		double timeScale() const { return m_timeScale; }
+
+		// 1 より小さければスロー、大きければ早送り
+		void setTimeScale(double timeScale) { m_timeScale = Clamp(timeScale, MinTimeScale, MaxTimeScale); }
+
+	private:
+
+		double m_timeScale = 1.0;
+
+		bool m_paused = false;
+	};
+
+	// 可変のフレーム時間をためて、固定の刻み (step) ごとに Game::update() するための数を出す
+	// 表示のリフレッシュレートやフレーム落ちに関わらず、1 回の update() で進む時間がいつも同じになる
+	// 詰まったフレームでも進めるのは maxSteps までにし、あふれた分は捨てる (追いつこうとしてさらに重くなるのを防ぐ)
+	class FixedTimestep
+	{
+	public:
+
+		explicit FixedTimestep(double step = TickDelta, int32 maxSteps = 8)
+			: m_step{ step }
+			, m_maxSteps{ maxSteps } {}
+
+		// delta 秒をためて、今進める刻みの数を返す
+		int32 advance(double delta)
+		{
+			m_accumulator += delta;
+
+			// 1/60 秒を 1/120 秒で割ったときの丸め誤差で 1 回分ずれないようにする
+			const int32 steps = std::min(static_cast<int32>(m_accumulator / m_step + 1e-6), m_maxSteps);
+			m_accumulator = std::max(0.0, m_accumulator - steps * m_step);
+
+			if (m_step <= m_accumulator)
+			{
+				m_accumulator = std::fmod(m_accumulator, m_step);
+			}
+
+			return steps;
+		}
+
+		double step() const { return m_step; }
+
+		// 最後の刻みから次の刻みまでのどこにいるか [0, 1)。描画の補間に使う
+		double alpha() const { return Clamp(m_accumulator / m_step, 0.0, 1.0); }
+
+		void reset() { m_accumulator = 0.0; }
+
+	private:
+
+		double m_step;
+
+		int32 m_maxSteps;
+
+		double m_accumulator = 0.0;
+	};
+}
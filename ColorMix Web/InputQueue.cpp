@@ -0,0 +1,83 @@
+# include <algorithm>
+# include "InputQueue.hpp"
+
+namespace ColorMix
+{
+	void InputQueue::push(const PointerEvent& event)
+	{
+		// ほとんどは末尾に足すだけで済む
+		const auto it = std::upper_bound(m_events.begin(), m_events.end(), event.time,
+			[](double time, const PointerEvent& e) { return time < e.time; });
+		m_events.insert(it, event);
+
+		if (m_latestTime <= event.time)
+		{
+			m_latestCursor = event.pos;
+			m_latestTime = event.time;
+		}
+	}
+
+	void InputQueue::drain(double time, std::vector<TickInput>& out)
+	{
+		TickInput input;
+		input.cursor = m_cursor;
+
+		size_t count = 0, added = 0;
+
+		for (; (count < m_events.size()) and (m_events[count].time <= time); ++count)
+		{
+			const PointerEvent& event = m_events[count];
+			bool split = false;
+
+			switch (event.type)
+			{
+			case PointerEventType::press:
+				split = (input.pressed or input.released);
+				break;
+
+			case PointerEventType::release:
+				// 押した位置と離した位置が違うなら、拾う tick と離す tick を分ける
+				split = (input.released or (input.pressed and ((input.cursor.x != event.pos.x) or (input.cursor.y != event.pos.y))));
+				break;
+
+			case PointerEventType::move:
+				// 押した・離した位置は動かさない
+				split = (input.pressed or input.released);
+				break;
+			}
+
+			if (split)
+			{
+				// 上限に達したら、このイベントから先は次の tick に回す
+				if (added + 1 == MaxInputsPerTick)
+				{
+					break;
+				}
+
+				out.push_back(input);
+				input = {};
+				++added;
+			}
+
+			if (event.type == PointerEventType::press)
+			{
+				input.pressed = true;
+			}
+			else if (event.type == PointerEventType::release)
+			{
+				input.released = true;
+			}
+
+			input.cursor = event.pos;
+		}
+
+		out.push_back(input);
+		m_cursor = input.cursor;
+		m_events.erase(m_events.begin(), m_events.begin() + count);
+	}
+
+	void InputQueue::clear()
+	{
+		m_events.clear();
+	}
+}
@@ -0,0 +1,67 @@
+# pragma once
+# include <vector>
+# include "Game.hpp"
+
+namespace ColorMix
+{
+	enum class PointerEventType : uint8
+	{
+		press,
+		move,
+		release,
+	};
+
+	// 時刻付きのポインター (マウス・タッチ) のイベント (盤面ローカル座標)
+	struct PointerEvent
+	{
+		PointerEventType type = PointerEventType::move;
+
+		Vec2 pos;
+
+		// 秒。基準はどこでもよいが、1 つの InputQueue の中では揃える
+		double time = 0.0;
+	};
+
+	// フレームの間に届いたポインターのイベントをためておき、tick ごとに TickInput の列にして取り出す
+	// 押して離すまでが 1 フレームに収まる速い操作も、押す・離すを 1 つずつ別の TickInput にするので落とさない
+	// Siv3D に依存しないので、ヘッドレスでも作ったイベント列をそのまま流せる
+	class InputQueue
+	{
+	public:
+
+		// 1 回の drain() で足す TickInput の上限。超える分は次の tick に回す
+		// ColorMix::Verify() はこれより多くの入力が 1 つの刻みにあるリプレイを認めない
+		static constexpr size_t MaxInputsPerTick = 8;
+
+		// 時刻が前後して届いてもよい。同じ時刻なら届いた順
+		void push(const PointerEvent& event);
+
+		// time までのイベントを取り出して out に TickInput を足す。最初のものに tick の delta を、残りには 0 を渡して update() する
+		// move は次の press / release にまとめる。イベントがなくても最後のカーソル位置で 1 つは足す (多くても MaxInputsPerTick 個)
+		void drain(double time, std::vector<TickInput>& out);
+
+		// 受け取った中で一番新しいカーソル位置 (まだ drain() していないものも含む)。描く直前のプレビューに使う
+		const Vec2& latestCursor() const
+		{
+			return m_latestCursor;
+		}
+
+		bool empty() const
+		{
+			return m_events.empty();
+		}
+
+		void clear();
+
+	private:
+
+		std::vector<PointerEvent> m_events;
+
+		// drain() で最後に渡したカーソル位置
+		Vec2 m_cursor;
+
+		Vec2 m_latestCursor;
+
+		double m_latestTime = 0.0;
+	};
+}
@@ -1,270 +1,635 @@
 # include <Siv3D.hpp> // Siv3D v0.6.14
+# include "Game.hpp"
+# include "GameClock.hpp"
+# include "InputQueue.hpp"
+# include "Profiler.hpp"
+# include "Replay.hpp"
 
-enum class ColorType
+# if SIV3D_PLATFORM(WEB)
+#	include <emscripten/emscripten.h>
+#	include <emscripten/html5.h>
+# endif
+
+using ColorMix::ColorType;
+
+// 表示色は混色ルールのセットが持っている (CMYMixRules なら減法混色の色)
+Color getColor(ColorType type)
 {
-	red,
-	yellow,
-	blue,
-	orange,
-	green,
-	purple,
-	black,
-};
+	const uint32 rgb = ColorMix::Game::Rules::Palette[static_cast<size_t>(type)];
+	return Color(static_cast<uint8>(rgb >> 16), static_cast<uint8>(rgb >> 8), static_cast<uint8>(rgb));
+}
 
-Optional<ColorType> getMixedColor(ColorType a, ColorType b)
+// ゲームのイベントを効果音にする
+// 音は起動時に一度だけ読み込み、音程を変えたものも先に作っておく。同じ音が 1 フレームに何度鳴っても 1 回にまとめ、同時に鳴る数も抑える
+struct GameAudio
 {
-	if (a == ColorType::red and b == ColorType::yellow or a == ColorType::yellow and b == ColorType::red)
+	enum class Sound : uint8
 	{
-		return ColorType::orange;
+		mix,
+		pop,
+		broke,
+		drop,
+		pick,
+	};
+
+	static constexpr size_t SoundCount = 5;
+
+	// 同じ音が同時に鳴る数の上限
+	static constexpr size_t MaxVoicesPerSound = 4;
+
+	struct Bank
+	{
+		// 低い順
+		Array<double> pitches;
+
+		Array<Audio> variants;
+
+		// このフレームに鳴らすもの
+		Array<bool> queued;
+
+		// 鳴っている音の終わる時刻
+		Array<double> voiceEndTimes;
+
+		// 音程を変えたものを作り終わるまで持つ元の音
+		Wave source;
+	};
+
+	std::array<Bank, SoundCount> banks;
+
+	static Wave MakePitchedWave(const Wave& source, double pitch)
+	{
+		if (source.isEmpty())
+		{
+			return source;
+		}
+
+		const size_t length = static_cast<size_t>(source.size() / pitch);
+		Wave wave(length, Arg::sampleRate = source.sampleRate());
+
+		for (size_t i = 0; i < length; ++i)
+		{
+			const double pos = i * pitch;
+			const size_t index = static_cast<size_t>(pos);
+			const size_t next = Min(index + 1, source.size() - 1);
+			const double t = pos - index;
+			wave[i].left = static_cast<float>(Math::Lerp(source[index].left, source[next].left, t));
+			wave[i].right = static_cast<float>(Math::Lerp(source[index].right, source[next].right, t));
+		}
+
+		return wave;
 	}
-	if (a == ColorType::red and b == ColorType::blue or a == ColorType::blue and b == ColorType::red)
+
+	// 作る音程 (低い順)
+	static Array<double> Pitches(Sound sound)
 	{
-		return ColorType::purple;
+		// Random(0.9, 1.1) / Random(0.8, 1.2) の代わりに、その範囲を 5 段階で持つ
+		const Array<double> narrow{ 0.9, 0.95, 1.0, 1.05, 1.1 };
+
+		switch (sound)
+		{
+		case Sound::pop:
+		{
+			// pop は連鎖ごとに 0.15 ずつ上がる (8 連鎖まで)
+			Array<double> popPitches = narrow;
+			for (int32 chain = 2; chain <= 8; ++chain)
+			{
+				popPitches << 1 + (chain - 1) * 0.15;
+			}
+			std::sort(popPitches.begin(), popPitches.end());
+			return popPitches;
+		}
+		case Sound::pick:
+			return{ 0.8, 0.9, 1.0, 1.1, 1.2 };
+		default:
+			return narrow;
+		}
 	}
-	if (a == ColorType::yellow and b == ColorType::blue or a == ColorType::blue and b == ColorType::yellow)
+
+	static FilePathView Path(Sound sound)
 	{
-		return ColorType::green;
+		switch (sound)
+		{
+		case Sound::mix:
+			return U"asset/SFX_UI_Click_Designed_Liquid_Generic_Open_2.wav";
+		case Sound::pop:
+			return U"asset/SFX_UI_Click_Organic_Pop_Thin_Generic_1.wav";
+		case Sound::broke:
+			return U"asset/SFX_UI_Click_Designed_Metallic_Negative_1.wav";
+		case Sound::drop:
+			return U"asset/SFX_UI_Click_Organic_Plastic_Soft_Generic_1.wav";
+		default:
+			return U"asset/SFX_UI_Click_Organic_Pop_Negative_2.wav";
+		}
 	}
-	if (a == ColorType::red and b == ColorType::green or a == ColorType::green and b == ColorType::red)
+
+	// 起動時に AssetLoader から呼ぶ。1 回の呼び出しが 1 フレームの読み込みの目安に収まるよう、
+	// 元の音を読むのと音程を変えたものを 1 つ作るのを分ける。全部作り終わるまでその音は鳴らさない
+	void loadSource(Sound sound)
 	{
-		return ColorType::black;
+		Bank& bank = banks[static_cast<size_t>(sound)];
+		bank.source = Wave{ Path(sound) };
+		bank.pitches = Pitches(sound);
+		bank.variants.clear();
 	}
-	if (a == ColorType::yellow and b == ColorType::purple or a == ColorType::purple and b == ColorType::yellow)
+
+	// loadSource() のあと、Pitches(sound).size() 回呼ぶ
+	void makeVariant(Sound sound)
 	{
-		return ColorType::black;
+		Bank& bank = banks[static_cast<size_t>(sound)];
+		const double pitch = bank.pitches[bank.variants.size()];
+		bank.variants.emplace_back((pitch == 1.0) ? bank.source : MakePitchedWave(bank.source, pitch));
+
+		if (bank.variants.size() == bank.pitches.size())
+		{
+			bank.source = Wave{};
+			bank.queued.assign(bank.pitches.size(), false);
+		}
 	}
-	if (a == ColorType::blue and b == ColorType::orange or a == ColorType::orange and b == ColorType::blue)
+
+	// pitch にいちばん近い音を予約する
+	void enqueue(Sound sound, double pitch)
 	{
-		return ColorType::black;
+		Bank& bank = banks[static_cast<size_t>(sound)];
+
+		if (bank.queued.isEmpty())
+		{
+			return;
+		}
+
+		const auto it = std::lower_bound(bank.pitches.begin(), bank.pitches.end(), pitch);
+		size_t index = Min(static_cast<size_t>(it - bank.pitches.begin()), bank.pitches.size() - 1);
+
+		if ((0 < index) && (pitch - bank.pitches[index - 1] < bank.pitches[index] - pitch))
+		{
+			--index;
+		}
+
+		bank.queued[index] = true;
 	}
-	return none;
-}
 
-Color getColor(ColorType type)
-{
-	switch (type)
-	{
-	case ColorType::red:
-		return Palette::Red;
-	case ColorType::yellow:
-		return Palette::Yellow;
-	case ColorType::blue:
-		return Palette::Blue;
-	case ColorType::orange:
-		return Palette::Orange;
-	case ColorType::green:
-		return Palette::Green;
-	case ColorType::purple:
-		return Palette::Purple;
-	case ColorType::black:
-		return Palette::Black;
-	default:
-		return Palette::White;
+	void enqueue(const ColorMix::GameEvent& event)
+	{
+		switch (event.type)
+		{
+		case ColorMix::GameEventType::mix:
+			enqueue(Sound::mix, Random(0.9, 1.1));
+			break;
+		case ColorMix::GameEventType::pop:
+			enqueue(Sound::pop, event.chain ? 1 + (event.chain - 1) * 0.15 : Random(0.9, 1.1));
+			break;
+		case ColorMix::GameEventType::broke:
+			enqueue(Sound::broke, Random(0.9, 1.1));
+			break;
+		case ColorMix::GameEventType::drop:
+			enqueue(Sound::drop, Random(0.9, 1.1));
+			break;
+		case ColorMix::GameEventType::pick:
+			enqueue(Sound::pick, Random(0.8, 1.2));
+			break;
+		}
 	}
-}
 
-//Real three color
-//Color getColor(ColorType type)
-//{
-//	switch (type)
-//	{
-//	case ColorType::red:
-//		return Palette::Magenta;
-//	case ColorType::yellow:
-//		return Palette::Yellow;
-//	case ColorType::blue:
-//		return Palette::Cyan;
-//	case ColorType::orange:
-//		return Palette::Red;
-//	case ColorType::green:
-//		return Palette::Green;
-//	case ColorType::purple:
-//		return Palette::Blue;
-//	case ColorType::black:
-//		return Palette::Black;
-//	default:
-//		return Palette::White;
-//	}
-//}
-
-struct ColorNode
-{
-	double y;
-	ColorType type;
-	int32 wasEnemy = 0;
-	bool beFixed = false;
-	bool bePicked = false;
-	Stopwatch monyuTimer{ StartImmediately::Yes };
-};
+	// 予約された音を鳴らす。上限を超えた分は捨てる
+	void flush()
+	{
+		const double now = Scene::Time();
 
-struct PickedNode
-{
-	ColorType type;
-	int32 wasEnemy = 0;
-};
+		for (auto& bank : banks)
+		{
+			bank.voiceEndTimes.remove_if([&](double endTime) { return endTime <= now; });
 
-struct ColorEnemy
-{
-	ColorType type;
-	bool beDissapear = false;
-};
+			for (size_t i = 0; i < bank.queued.size(); ++i)
+			{
+				if (not bank.queued[i])
+				{
+					continue;
+				}
 
-struct FixedColorNode {
-	ColorType type;
-	int32 wasEnemy = 0;
-	bool beDisappear = false;
-};
+				bank.queued[i] = false;
 
-struct NodePoper {
-	double y;
-	ColorType type;
-	double speed = 0;
-	int32 count = 0;
-};
+				if (MaxVoicesPerSound <= bank.voiceEndTimes.size())
+				{
+					continue;
+				}
 
-struct Halo {
-	Vec2 pos;
-	Stopwatch lifeTimer{ StartImmediately::Yes };
+				bank.variants[i].playOneShot();
+				bank.voiceEndTimes << (now + bank.variants[i].lengthSec());
+			}
+		}
+	}
 };
 
-struct Game
+// マウスとタッチの押す・動かす・離すを、時刻付きで InputQueue に積む
+// Web 版はブラウザのイベントを受け取ったその場で積むので、フレームの間に押して離しても落ちない
+// それ以外の環境ではフレームの頭に MouseL と Cursor を見て積む
+class PointerInput
 {
-	Grid<Optional<FixedColorNode>> fixedNodeGrid;
-	Grid<Optional<ColorEnemy>> enemyGrid;
-	Array<Array<ColorNode>> nodesLanes;
-	Array<Array<NodePoper>> nodePopers;
+public:
 
+	PointerInput() = default;
 
-	static constexpr double width = 360.0;
-	static constexpr double laneHeight = 500.0;
-	static constexpr double enemySpanLength = 65;
-	static constexpr Size gridSize = { 5,static_cast<int32>(laneHeight / enemySpanLength * 2) };
-	static constexpr double oneLaneWidth = width / gridSize.x;
-	static constexpr int32 startEnemySetIndexY = static_cast<int32>(laneHeight / enemySpanLength * 1.5);
-	static constexpr double firstEenemySpeed = 4.0;
-	double enemySpeed = firstEenemySpeed;
+	PointerInput(const PointerInput&) = delete;
 
-	static constexpr double nodeSpeed = 20.0;
+	PointerInput& operator=(const PointerInput&) = delete;
 
+	// イベントの時刻 [秒]
+	static double Now()
+	{
+		return Time::GetMicrosec() * 1e-6;
+	}
 
-	double stageProgress = startEnemySetIndexY * enemySpanLength;
-	int32 enemySetIndexY = startEnemySetIndexY;
-	static constexpr double enemyAppearY = -enemySpanLength * 2;
-	int32 progressIndex = 0;
+	void attach(ColorMix::InputQueue& queue)
+	{
+		m_queue = &queue;
+
+	# if SIV3D_PLATFORM(WEB)
+		// Siv3D 側のイベント処理も生かしておくため、どれも preventDefault しない (false を返す)
+		// 押すのはキャンバスの上だけだが、ドラッグ中にキャンバスの外へ出て離すこともあるので、動かす・離すはウィンドウで受け取る
+		emscripten_set_mousedown_callback("#canvas", this, false, OnMouse);
+		emscripten_set_mousemove_callback(EMSCRIPTEN_EVENT_TARGET_WINDOW, this, false, OnMouse);
+		emscripten_set_mouseup_callback(EMSCRIPTEN_EVENT_TARGET_WINDOW, this, false, OnMouse);
+		emscripten_set_touchstart_callback("#canvas", this, false, OnTouch);
+		emscripten_set_touchmove_callback("#canvas", this, false, OnTouch);
+		emscripten_set_touchend_callback("#canvas", this, false, OnTouch);
+		emscripten_set_touchcancel_callback("#canvas", this, false, OnTouch);
+	# endif
+	}
 
-	static constexpr double upSpaceY = 50;
+	// フレームの頭に呼ぶ。offset は盤面の左上 (シーン座標)
+	void poll(const Vec2& offset)
+	{
+		m_offset = offset;
+
+	# if not SIV3D_PLATFORM(WEB)
+		const Vec2 pos = Cursor::PosF();
+		push(ColorMix::PointerEventType::move, pos);
 
+		if (MouseL.down())
+		{
+			push(ColorMix::PointerEventType::press, pos);
+		}
 
-	static constexpr Vec2 pickWaitingPos = Vec2(width / 2, 510);
-	Optional<ColorType> waitingNode;
-	Array<ColorType> nextNodes;
-	Stopwatch waitNodeSetTimer;
+		if (MouseL.up())
+		{
+			push(ColorMix::PointerEventType::release, pos);
+		}
+	# endif
+	}
 
-	static constexpr double waitingNodeRadius = oneLaneWidth * 0.45;
+private:
 
-	Array<ColorType> NodeSetToShuffle = { ColorType::red,ColorType::yellow,ColorType::blue,ColorType::red,ColorType::yellow,ColorType::blue };
-	Array<ColorType> shuffledNodeStack;
+	ColorMix::InputQueue* m_queue = nullptr;
 
-	Optional<PickedNode> pickingNode;
-	Vec2 predictedPos;
-	Optional<double> pickingUnderLimitY = 0.0;
-	int32 prevLaneIndex;
+	Vec2 m_offset{ 0, 0 };
 
+	void push(ColorMix::PointerEventType type, const Vec2& scenePos)
+	{
+		if (m_queue)
+		{
+			const Vec2 pos = scenePos - m_offset;
+			m_queue->push({ type, { pos.x, pos.y }, Now() });
+		}
+	}
 
-	int32 score = 0;
+# if SIV3D_PLATFORM(WEB)
 
+	// 追っているタッチの identifier。触れていなければ -1
+	long m_touchId = -1;
 
+	// タッチのあとにブラウザが作るマウスイベントは無視する
+	double m_lastTouchTime = -1.0;
 
-	Game()
+	// ページの CSS ピクセル (clientX, clientY) からシーン座標へ
+	// キャンバスとシーンの縦横比が違うとき、シーンは縦横比を保ったままキャンバスの中央に拡大して描かれる (上下か左右に帯が入る) ので、その分も戻す
+	static Vec2 ToScene(double clientX, double clientY)
 	{
-		fixedNodeGrid.resize(gridSize);
-		enemyGrid.resize(gridSize);
-		nodesLanes.resize(gridSize.x);
-		nodePopers.resize(gridSize.x);
-		waitNodeSetTimer.restart();
-		nextNodes.resize(3);
-		shuffledNodeStack = NodeSetToShuffle.shuffled();
-		for (auto& node : nextNodes)
+		const double left = EM_ASM_DOUBLE({ return Module['canvas'].getBoundingClientRect().left; });
+		const double top = EM_ASM_DOUBLE({ return Module['canvas'].getBoundingClientRect().top; });
+		const Vec2 pos{ clientX - left, clientY - top };
+
+		double cssWidth = 0, cssHeight = 0;
+		emscripten_get_element_css_size("#canvas", &cssWidth, &cssHeight);
+
+		if ((cssWidth <= 0) or (cssHeight <= 0))
 		{
-			node = shuffledNodeStack.back();
-			shuffledNodeStack.pop_back();
+			return pos;
 		}
+
+		const double scale = Min(cssWidth / Scene::Width(), cssHeight / Scene::Height());
+		const Vec2 letterbox{ (cssWidth - Scene::Width() * scale) / 2, (cssHeight - Scene::Height() * scale) / 2 };
+		return (pos - letterbox) / scale;
 	}
 
-	void init() {
-		fixedNodeGrid.clear();
-		fixedNodeGrid.resize(gridSize);
-		enemyGrid.clear();
-		enemyGrid.resize(gridSize);
-		nodesLanes.clear();
-		nodesLanes.resize(gridSize.x);
-		nodePopers.clear();
-		nodePopers.resize(gridSize.x);
-		waitNodeSetTimer.restart();
-		waitingNode.reset();
-		shuffledNodeStack = NodeSetToShuffle.shuffled();
-		for (auto& node : nextNodes)
-		{
-			node = shuffledNodeStack.back();
-			shuffledNodeStack.pop_back();
-		}
-		enemySpeed = firstEenemySpeed;
-		stageProgress = startEnemySetIndexY * enemySpanLength;
-		enemySetIndexY = startEnemySetIndexY;
-		progressIndex = 0;
-		score = 0;
-		pickingNode.reset();
-		pickingUnderLimitY.reset();
+	static EM_BOOL OnMouse(int eventType, const EmscriptenMouseEvent* e, void* userData)
+	{
+		PointerInput& self = *static_cast<PointerInput*>(userData);
+
+		if ((Now() - self.m_lastTouchTime) < 0.5)
+		{
+			return false;
+		}
+
+		const Vec2 pos = ToScene(e->clientX, e->clientY);
+
+		if (eventType == EMSCRIPTEN_EVENT_MOUSEMOVE)
+		{
+			self.push(ColorMix::PointerEventType::move, pos);
+		}
+		else if (e->button == 0)
+		{
+			self.push((eventType == EMSCRIPTEN_EVENT_MOUSEDOWN) ? ColorMix::PointerEventType::press : ColorMix::PointerEventType::release, pos);
+		}
+
+		return false;
 	}
 
-	bool isGameOver() const
+	static EM_BOOL OnTouch(int eventType, const EmscriptenTouchEvent* e, void* userData)
 	{
-		for (auto lane_i : step(gridSize.x)) {
-			for (auto y_i : step(gridSize.y)) {
-				Point index = { lane_i,y_i };
-				if (fixedNodeGrid[index] or enemyGrid[index]) {
-					if (fixedNodeCenterYReal(y_i) > laneHeight + enemySpanLength / 2)return true;
-					break;
+		PointerInput& self = *static_cast<PointerInput*>(userData);
+		self.m_lastTouchTime = Now();
+
+		// 1 本目の指だけを追う
+		for (int i = 0; i < e->numTouches; ++i)
+		{
+			const EmscriptenTouchPoint& touch = e->touches[i];
+
+			if (not touch.isChanged)
+			{
+				continue;
+			}
+
+			const Vec2 pos = ToScene(touch.clientX, touch.clientY);
+
+			if ((eventType == EMSCRIPTEN_EVENT_TOUCHSTART) and (self.m_touchId == -1))
+			{
+				self.m_touchId = touch.identifier;
+				self.push(ColorMix::PointerEventType::press, pos);
+			}
+			else if (touch.identifier == self.m_touchId)
+			{
+				if (eventType == EMSCRIPTEN_EVENT_TOUCHMOVE)
+				{
+					self.push(ColorMix::PointerEventType::move, pos);
+				}
+				else if ((eventType == EMSCRIPTEN_EVENT_TOUCHEND) or (eventType == EMSCRIPTEN_EVENT_TOUCHCANCEL))
+				{
+					self.m_touchId = -1;
+					self.push(ColorMix::PointerEventType::release, pos);
 				}
 			}
 		}
+
 		return false;
 	}
 
-	double laneCenterX(size_t laneIndex) const
+# endif
+};
+
+// 起動時の読み込みを、積んだ順 (優先度の高い順) に 1 フレームあたり budget 秒を目安に進める
+// Web 版はスレッドなしでビルドしているので、別スレッドではなくフレームの頭で少しずつ読む。1 フレームに少なくとも 1 つは読む
+// neededForStart のものが全部読めたら操作できる (start を押せる)。全部読めたら isComplete() になり、そのあとは読み込みが起きない
+class AssetLoader
+{
+public:
+
+	void add(std::function<void()> load, bool neededForStart)
+	{
+		m_jobs.push_back({ std::move(load), neededForStart });
+
+		if (neededForStart)
+		{
+			++m_remainingForStart;
+		}
+	}
+
+	void update(double budget)
+	{
+		const uint64 start = Time::GetMicrosec();
+
+		while (m_next < m_jobs.size())
+		{
+			Job& job = m_jobs[m_next++];
+			job.load();
+			job.load = nullptr;
+
+			if (job.neededForStart)
+			{
+				--m_remainingForStart;
+			}
+
+			if (budget * 1e6 <= static_cast<double>(Time::GetMicrosec() - start))
+			{
+				break;
+			}
+		}
+
+		if ((not m_timeToInteractive) and isInteractive())
+		{
+			m_timeToInteractive = elapsed();
+			Logger << U"time to interactive: {:.1f} ms"_fmt(*m_timeToInteractive * 1e3);
+		}
+
+		if ((not m_timeToComplete) and isComplete())
+		{
+			m_timeToComplete = elapsed();
+			Logger << U"all assets loaded: {:.1f} ms"_fmt(*m_timeToComplete * 1e3);
+		}
+	}
+
+	bool isInteractive() const
+	{
+		return (m_remainingForStart == 0);
+	}
+
+	bool isComplete() const
+	{
+		return (m_next == m_jobs.size());
+	}
+
+	// 0 から 1
+	double progress() const
+	{
+		return m_jobs.empty() ? 1.0 : static_cast<double>(m_next) / m_jobs.size();
+	}
+
+	// 計測の基準から操作できるようになるまで / 全部読めるまでの時間 [秒]
+	const Optional<double>& timeToInteractive() const
+	{
+		return m_timeToInteractive;
+	}
+
+	const Optional<double>& timeToComplete() const
+	{
+		return m_timeToComplete;
+	}
+
+private:
+
+	struct Job
+	{
+		std::function<void()> load;
+
+		bool neededForStart = false;
+	};
+
+	Array<Job> m_jobs;
+
+	// 次に読むもの
+	size_t m_next = 0;
+
+	size_t m_remainingForStart = 0;
+
+	uint64 m_startMicrosec = Time::GetMicrosec();
+
+	Optional<double> m_timeToInteractive;
+
+	Optional<double> m_timeToComplete;
+
+	// Web 版はページを開いてから (performance.now())、それ以外は AssetLoader を作ってから
+	double elapsed() const
 	{
-		return laneIndex * oneLaneWidth + oneLaneWidth / 2;
+	# if SIV3D_PLATFORM(WEB)
+		return emscripten_get_now() * 1e-3;
+	# else
+		return (Time::GetMicrosec() - m_startMicrosec) * 1e-6;
+	# endif
+	}
+};
+
+struct GameView
+{
+	ColorMix::Game game;
+
+	// 一時停止・スロー・早送り。アニメーションは game.time から計算するので、これで全体の速さが変わる
+	ColorMix::GameClock clock;
+
+	// ゲームは 120 Hz の固定の刻みで進め、描くときは刻みの間を補間する
+	ColorMix::FixedTimestep timestep{ ColorMix::TickDelta, 8 };
+
+	// 最後にイベントを取り出した時刻 (PointerInput::Now())
+	double lastDrainTime = 0.0;
+
+	// 今のゲームの seed と入力の記録
+	ColorMix::Replay replay;
+
+	// フレームの間に届いたポインターのイベント。tick ごとに TickInput の列にして取り出す
+	ColorMix::InputQueue inputQueue;
+
+	PointerInput pointer;
+
+	std::vector<ColorMix::TickInput> tickInputs;
+
+	// 描く直前に取った最新のカーソル位置 (盤面ローカル座標)。ドラッグ中のプレビューに使う
+	ColorMix::Vec2 latchedCursor;
+
+	GameAudio audio;
+
+	static constexpr double width = ColorMix::Game::width;
+	static constexpr double laneHeight = ColorMix::Game::laneHeight;
+	static constexpr double enemySpanLength = ColorMix::Game::enemySpanLength;
+	static constexpr double oneLaneWidth = ColorMix::Game::oneLaneWidth;
+
+	static constexpr double upSpaceY = 50;
+
+	static constexpr Vec2 pickWaitingPos = Vec2(ColorMix::Game::pickWaitingPos.x, ColorMix::Game::pickWaitingPos.y);
+	static constexpr double waitingNodeRadius = ColorMix::Game::waitingNodeRadius;
+
+	// glossy_node の種類 (UV.x の整数部 / 4)
+	enum class GlossyKind : int32
+	{
+		node,
+		fixedNode,
+		enemy,
+	};
+
+	// 四角形の半分の大きさ (半径比)。影の分だけ大きくとる。シェーダーの GlossyExtent と合わせる
+	static constexpr double glossyExtent = 1.25;
+
+	// ノード・固定ノード・敵を 1 枚の四角形で描くシェーダー。読み込めなければ図形で描く
+	PixelShader glossyShader = ESSL{ U"resources/shader/essl/glossy_node.frag", { { U"PSConstants2D", 0 } } }
+		| WGSL{ U"resources/shader/wgsl/glossy_node.frag.wgsl", { { U"PSConstants2D", 0 } } };
+
+	// 色はシェーダーで作るので、テクスチャは UV を渡すためだけのもの
+	Texture glossyTexture{ Image{ 1, 1, Palette::White } };
+
+	// 動かない背景 (ノードの下) と上下のパネル (ノードの上)。シーンの大きさが変わったときだけ描き直す
+	mutable Size layerSceneSize{ 0, 0 };
+	mutable RenderTexture backgroundLayer;
+	mutable RenderTexture panelLayer;
+
+	GameView()
+		: game{ RandomUint64() }
+	{
+		pointer.attach(inputQueue);
+	}
+
+	void init() {
+		const uint64 seed = RandomUint64();
+		game.init(seed);
+		clock.setPaused(false);
+		timestep.reset();
+		inputQueue.clear();
+		lastDrainTime = PointerInput::Now();
+		replay = {};
+		replay.seed = seed;
 	}
 
-	double fixedNodeCenterY(int32 n) const
+	// 記録を replay/ に保存する。重くなったときやおかしな動きをしたときに ColorMixReplay で再現する
+	// Web 版は書いてもメモリ上のファイルシステムに溜まるだけで取り出せないので、プロファイル用のビルド以外では書かない
+	void saveReplay()
 	{
-		return -enemySpanLength * n - enemySpanLength / 2 + stageProgress;
+	# if (not SIV3D_PLATFORM(WEB)) or COLORMIX_PROFILE
+		if (replay.frames.empty())
+		{
+			return;
+		}
+
+		replay.finish(game);
+
+		const auto data = replay.serialize();
+		BinaryWriter writer{ U"replay/{}.cmrp"_fmt(DateTime::Now().format(U"yyyyMMdd-HHmmss")) };
+		writer.write(data.data(), data.size());
+	# endif
 	}
 
-	int32 nodeIndexAtY(double y) const
+	bool isGameOver() const
 	{
-		return static_cast<int32>(Floor((stageProgress - y) / enemySpanLength));
+		return game.isGameOver();
 	}
 
-	int32 nodeIndexAtYReal(double y) const
+	double laneCenterX(size_t laneIndex) const
 	{
-		return nodeIndexAtY(y) - progressIndex;
+		return game.laneCenterX(laneIndex);
 	}
 
 	double fixedNodeCenterYReal(int32 n) const
 	{
-		return fixedNodeCenterY(n + progressIndex);
+		return game.fixedNodeCenterYReal(n);
 	}
 
 	double nodeRadius() const
 	{
-		return oneLaneWidth * 0.4;
+		return game.nodeRadius();
+	}
+
+	// ScopedCustomShader2D{ glossyShader } の中で呼ぶ。色相と黒かどうかを頂点色に、種類を UV に入れる
+	void drawGlossy(GlossyKind kind, const Vec2& pos, double r, ColorType c, double scaleX = 1, double scaleY = 1) const
+	{
+		const ColorF params{ HSV(getColor(c)).h / 360.0, (c == ColorType::black) ? 0.0 : 1.0, 0.0, 1.0 };
+		const double u = static_cast<int32>(kind) * 4 + 1;
+		const double size = r * glossyExtent * 2;
+		glossyTexture.uv(u, 0, 1, 1).resized(size * scaleX, size * scaleY).drawAt(pos, params);
 	}
 
 	void drawEnemy(const Vec2& pos, ColorType c) const
 	{
 		double oneEdge = oneLaneWidth * 0.8;
 
+		if (glossyShader) {
+			drawGlossy(GlossyKind::enemy, pos, oneEdge / 2, c);
+			return;
+		}
+
 		if (c == ColorType::black) {
 			RoundRect(Arg::center = pos, oneEdge, oneEdge, 10).drawShadow({ 0,0 }, 10, 0, ColorF(0.2, 0.7));
 			RoundRect(Arg::center = pos, oneEdge, oneEdge, 10).draw(ColorF(0.2));
@@ -289,6 +654,11 @@ struct Game
 
 	void drawNode(const Vec2& pos, double r, ColorType c) const
 	{
+		if (glossyShader) {
+			drawGlossy(GlossyKind::node, pos, r, c);
+			return;
+		}
+
 		if (c == ColorType::black)
 		{
 			Circle(pos, r).drawShadow({ 0,0 }, r * 0.3, 0, ColorF(0.2, 0.7));
@@ -335,14 +705,27 @@ struct Game
 		}
 	}
 
-	void drawNode(const Vec2& pos, double r, ColorType c, const Stopwatch& monyuTimer) const {
-		double attenuation = 1 - EaseInOutExpo(monyuTimer.sF());
-		Transformer2D scale(Mat3x2::Scale(1 + 0.05 * Sin(monyuTimer.sF() * 20 + Math::HalfPi) * attenuation, 1 + 0.05 * Sin(monyuTimer.sF() * 20) * attenuation, pos));
+	void drawNode(const Vec2& pos, double r, ColorType c, double monyuTime) const {
+		double attenuation = 1 - EaseInOutExpo(monyuTime);
+		double scaleX = 1 + 0.05 * Sin(monyuTime * 20 + Math::HalfPi) * attenuation;
+		double scaleY = 1 + 0.05 * Sin(monyuTime * 20) * attenuation;
+
+		// Transformer2D を挟むとバッチが切れるので、四角形そのものを伸び縮みさせる
+		if (glossyShader) {
+			drawGlossy(GlossyKind::node, pos, r, c, scaleX, scaleY);
+			return;
+		}
+
+		Transformer2D scale(Mat3x2::Scale(scaleX, scaleY, pos));
 		drawNode(pos, r, c);
 	}
 
 	void drawFixedNode(const Vec2& pos, double r, ColorType c) const
 	{
+		if (glossyShader) {
+			drawGlossy(GlossyKind::fixedNode, pos, r, c);
+			return;
+		}
 
 		if (c == ColorType::black)
 		{
@@ -397,459 +780,437 @@ struct Game
 		RoundRect(Arg::center = pos, oneEdge, oneEdge, 10).draw(color);
 	}
 
-	void progressGrid() {
-		progressIndex++;
-		enemyGrid.remove_row(0);
-		enemyGrid.push_back_row(none);
-		fixedNodeGrid.remove_row(0);
-		fixedNodeGrid.push_back_row(none);
-	}
+	// realDelta は実時間。clock で一時停止・スロー・早送りを掛けてからゲームを進める
+	// 前のフレームからの時間を固定の刻みに分けて進める
+	// イベントは届いた時刻に応じて刻みに振り分け、1 つずつ順に update() する。刻みの 2 つ目からの入力は delta を 0 にする
+	void update(double realDelta)
+	{
+		pointer.poll(boardOffset());
+		const double now = PointerInput::Now();
 
-	void tellGridBecomeEmpty(const Point& index) {
-		Point downIndex = index - Point(0, 1);
-		if (fixedNodeGrid.inBounds(downIndex)) {
-			if (auto& fixedNode = fixedNodeGrid[downIndex]) {
-				nodesLanes[index.x].push_back({ fixedNodeCenterYReal(downIndex.y), fixedNode->type,fixedNode->wasEnemy });
-				fixedNode.reset();
-				tellGridBecomeEmpty(downIndex);
-			}
+		if (clock.isPaused())
+		{
+			// 止めている間の操作は捨てる
+			inputQueue.clear();
+			lastDrainTime = now;
+			return;
 		}
-	}
 
-	void update(double delta)
-	{
-		Transformer2D tf(Mat3x2::Translate((Scene::Width() - width) / 2, upSpaceY), TransformCursor::Yes);
+		const int32 steps = timestep.advance(clock.gameDelta(realDelta));
+
+		for (int32 s = 0; s < steps; ++s)
+		{
+			tickInputs.clear();
+			inputQueue.drain(lastDrainTime + (now - lastDrainTime) * (s + 1) / steps, tickInputs);
+
+			for (size_t i = 0; i < tickInputs.size(); ++i)
+			{
+				// ゲームオーバーのあとは進めず、記録もしない (ColorMixVerify はそのあとの frame があるリプレイを認めない)
+				if (game.isGameOver())
+				{
+					break;
+				}
 
-		enemySpeed += delta * 0.02;
+				// 記録した値 (丸めたもの) で進めておけば、再生したときに同じ結果になる
+				const ColorMix::ReplayFrame& frame = replay.record(((i == 0) ? timestep.step() : 0.0), tickInputs[i]);
+				game.update(frame.delta, frame.input);
 
-		stageProgress += delta * enemySpeed;
+				for (const auto& event : game.events)
+				{
+					audio.enqueue(event);
+				}
+			}
+		}
 
-		while (static_cast<int32>(stageProgress / enemySpanLength) - startEnemySetIndexY > progressIndex)
+		// 刻みが来なかったフレームのイベントは次のフレームに回す
+		if (0 < steps)
 		{
-			progressGrid();
+			lastDrainTime = now;
 		}
 
+		audio.flush();
+	}
 
-		Array<Point> emptyGrids;
+	// 前の刻みから今の刻みまでを timestep.alpha() で補間した y
+	double interpolatedY(double prevY, double y) const
+	{
+		return Math::Lerp(prevY, y, timestep.alpha());
+	}
 
-		for (auto [lane_i, lane] : IndexedRef(nodesLanes))
-		{
+	// 補間した stageProgress と今の stageProgress の差。敵と固定ノードの y に足す
+	double scrollLag() const
+	{
+		return interpolatedY(game.prevStageProgress, game.stageProgress) - game.stageProgress;
+	}
 
+	// draw() の直前に呼ぶ。まだ tick に渡していないイベントも含めた最新のカーソル位置を取る
+	// 意味があるのは Web 版だけ (ブラウザのイベントで積むので、刻みが来なかったフレームの動きも拾える)
+	// それ以外の環境ではフレームの頭の poll() で積んだ位置そのままなので、遅延は縮まない
+	void latchCursor()
+	{
+		latchedCursor = inputQueue.latestCursor();
+	}
 
+	Vec2 boardOffset() const
+	{
+		return Vec2((Scene::Width() - width) / 2, upSpaceY);
+	}
 
-			for (auto& node : lane)
-			{
-				node.y -= delta * nodeSpeed;
+	void drawBackground() const
+	{
+		//draw border
+		constexpr double borderSize = 40;
+		for (auto i : step(static_cast<int32>(Ceil(laneHeight / borderSize))))
+		{
+			Color c = i % 2 == 0 ? Palette::Mistyrose : Palette::Lavenderblush;
+			RectF(-20, i * borderSize, width + 40, borderSize).draw(c);
+		}
 
-				for (auto& other : lane) {
-					if (&node == &other)continue;
-					double sub = node.y - other.y;
-					if (Abs(sub) < enemySpanLength)
-					{
-						if (sub > 0)
-						{
-							double over = enemySpanLength - sub;
-							node.y += over / 2;
-							other.y += -over / 2;
-						}
-						else
-						{
-							double over = enemySpanLength + sub;
-							node.y += -over / 2;
-							other.y += over / 2;
-						}
-					}
-				}
+		RectF(0, 0, width, laneHeight).drawShadow({ 0,0 }, 20);
 
-				double upperLimitY = fixedNodeCenterYReal(nodeIndexAtYReal(0)) + enemySpanLength;
-				if (node.y < upperLimitY)
-				{
-					node.y = upperLimitY;
-				}
+		for (auto i : step(ColorMix::Game::gridSize.x))
+		{
+			Color c = i % 2 == 0 ? ColorF(0.8, 1, 1) : ColorF(0.9, 1, 1);
+			RectF(i * oneLaneWidth, 0, oneLaneWidth, laneHeight).draw(c);
+		}
 
-				//find collision
-				Point findIndex = { lane_i,nodeIndexAtYReal(node.y - enemySpanLength / 2) };
-				bool found = false;
+		//Quad({ 0,laneHeight }, { width,laneHeight }, { width + 100,laneHeight + 200 }, {-100,laneHeight+200}).draw(ColorF(0.6, 0.8, 0.8));
+	}
 
-				if (fixedNodeGrid.inBounds(findIndex)) {
-					if (fixedNodeGrid[findIndex]) {
-						found = true;
-					}
-					if (enemyGrid[findIndex]) {
-						found = true;
-					}
-				}
+	void drawPanels() const
+	{
+		RectF(-100, -100, width + 200, 100).drawShadow({ 0,0 }, 20).draw(Palette::Blanchedalmond).drawFrame(2, Palette::Gray);
 
-				if (found)
-				{
-					Point pushIndex = findIndex + Point(0, -1);
-					node.y = fixedNodeCenterYReal(pushIndex.y);
-					node.beFixed = true;
-					if (fixedNodeGrid.inBounds(pushIndex)) {
-						fixedNodeGrid[pushIndex] = FixedColorNode{ node.type,node.wasEnemy };
-
-						//find around
-						bool foundAround = false;
-						for (Point rp : {Point{0, 1}, Point{ 1,0 }, Point{ 0,-1 }, Point{ -1,0 }}) {
-							Point aroundIndex = pushIndex + rp;
-							if (enemyGrid.inBounds(aroundIndex)) {
-								if (auto& o = enemyGrid[aroundIndex])
-								{
-									if (o->type == node.type)
-									{
-										o.reset();
-										emptyGrids.push_back(aroundIndex);
-										nodePopers[aroundIndex.x].push_back({ fixedNodeCenterYReal(aroundIndex.y) ,node.type });
-										score += 1;
-										AudioAsset(U"broke").playOneShot(1, 0, Random(0.9, 1.1));
-										foundAround = true;
-									}
-								}
-								else if (auto& o = fixedNodeGrid[aroundIndex])
-								{
-									if (o->type == node.type)
-									{
-										score += o->wasEnemy;
-										o.reset();
-										emptyGrids.push_back(aroundIndex);
-										AudioAsset(U"pop").playOneShot(1, 0, Random(0.9, 1.1));
-										foundAround = true;
-									}
-								}
-							}
-						}
-						if (foundAround) {
-							score += fixedNodeGrid[pushIndex]->wasEnemy;
-							fixedNodeGrid[pushIndex].reset();
-							emptyGrids.push_back(pushIndex);
-						}
-					}
+		RectF(-100, laneHeight, width + 200, 100).drawShadow({ 0,0 }, 20).draw(Palette::Blanchedalmond).drawFrame(2, Palette::Gray);
 
 
-				}
-			}
+		Circle(pickWaitingPos, waitingNodeRadius + 6).drawShadow({}, 10).draw(Palette::Beige);
+	}
 
-			lane.remove_if([](const ColorNode& node) {return node.beFixed; });
+	void refreshLayers() const
+	{
+		if (layerSceneSize == Scene::Size())
+		{
+			return;
 		}
 
-		for (auto& index : emptyGrids) {
-			tellGridBecomeEmpty(index);
-		}
+		layerSceneSize = Scene::Size();
+		backgroundLayer = RenderTexture{ layerSceneSize, Palette::Beige };
+		panelLayer = RenderTexture{ layerSceneSize, ColorF(0, 0) };
 
-		for (auto [lane_i, lane] : IndexedRef(nodePopers))
+		const Transformer2D tf(Mat3x2::Translate(boardOffset()));
 		{
-			for (auto& p : lane)
-			{
-				int32 preN = nodeIndexAtYReal(p.y);
-				p.y += delta * (enemySpeed + p.speed);
-				p.speed += delta * 1500;
-				int32 postN = nodeIndexAtYReal(p.y);
-
-				for (int32 i = preN; i > postN; i--)
-				{
-					Point findIndex = { lane_i,i };
-					if (enemyGrid.inBounds(findIndex)) {
-						if (auto& o = enemyGrid[findIndex])
-						{
-
-							ColorNode node = { fixedNodeCenterYReal(i), o->type };
-							node.wasEnemy = 1;
-							nodesLanes[lane_i].push_back(node);
-							AudioAsset(U"pop").playOneShot(1, 0, 1 + p.count * 0.15);
-							p.count++;
-							o.reset();
-							tellGridBecomeEmpty(findIndex);
-						}
-					}
-				}
-			}
+			const ScopedRenderTarget2D target{ backgroundLayer };
+			drawBackground();
 		}
-
-		while (nodeIndexAtY(enemyAppearY) >= enemySetIndexY)
 		{
-			int32 n = Random(4, gridSize.x);
-			n = gridSize.x;
-			//配列からランダムにｎ個選ぶ処理
-			Array<int32> indexes = step(static_cast<int32>(gridSize.x));
-			indexes.shuffle();
-			indexes.resize(n);
-			for (auto i : indexes)
-			{
-				Point p = { i,enemySetIndexY - progressIndex };
-				if (enemyGrid.inBounds(p))
-				{
-					enemyGrid[p] = ColorEnemy{ ColorType(Random(0, 6)) };
-				}
-			}
-			enemySetIndexY++;
+			const ScopedRenderTarget2D target{ panelLayer };
+			const ScopedRenderStates2D states{ LayerBlendState() };
+			drawPanels();
 		}
+	}
 
-		if (not pickingNode and waitingNode and Circle(pickWaitingPos, waitingNodeRadius).leftClicked())
-		{
-			pickingNode = PickedNode{ *waitingNode };
-			waitingNode.reset();
-			waitNodeSetTimer.restart();
+	// 透明なレンダーテクスチャに描くときのブレンド。色はアルファを掛けた値 (premultiplied) で残り、アルファは重ねた分だけ増える
+	// そのまま通常のブレンドで描くとアルファが 2 回掛かって縁が黒ずむので、描くときは DrawLayer() を使う
+	static BlendState LayerBlendState()
+	{
+		BlendState blend = BlendState::Default2D;
+		blend.srcAlpha = Blend::One;
+		blend.dstAlpha = Blend::InvSrcAlpha;
+		blend.opAlpha = BlendOp::Add;
+		return blend;
+	}
 
-			AudioAsset(U"pick2").playOneShot(1, 0, Random(0.8, 1.2));
-		}
+	// LayerBlendState() で描いたレンダーテクスチャを描く
+	static void DrawLayer(const RenderTexture& layer, const Vec2& pos = Vec2(0, 0))
+	{
+		const ScopedRenderStates2D states{ BlendState::Premultiplied };
+		layer.draw(pos);
+	}
 
-		if (not pickingNode) {
-			bool picked = false;
-			size_t laneIndex = static_cast<size_t>(Clamp<int32>(Cursor::PosF().x / oneLaneWidth, 0, gridSize.x - 1));
-			for (auto& node : nodesLanes[laneIndex])
-			{
-				if (Abs(node.y - Cursor::PosF().y) < 20 and MouseL.down())
-				{
-					pickingNode = { node.type,node.wasEnemy };
-					node.bePicked = true;
-					pickingUnderLimitY = node.y - stageProgress;
-					picked = true;
-					AudioAsset(U"pick2").playOneShot(1, 0, Random(0.8, 1.2));
-					break;
-				}
-			}
-			if (picked) {
-				nodesLanes[laneIndex].remove_if([](const ColorNode& node) {return node.bePicked; });
-			}
+	void draw() const
+	{
+		{
+			COLORMIX_PROFILE_SCOPE(drawBackground);
+			refreshLayers();
+			backgroundLayer.draw();
 		}
 
-		if (waitNodeSetTimer > 0.1s and not waitingNode) {
-			if (nextNodes) {
-				waitingNode = nextNodes[0];
-				nextNodes.erase(nextNodes.begin());
-
-				if (not shuffledNodeStack) {
-					shuffledNodeStack = NodeSetToShuffle.shuffled();
-				}
+		Transformer2D tf(Mat3x2::Translate(boardOffset()), TransformCursor::Yes);
 
-				nextNodes.push_back(shuffledNodeStack.back());
-				shuffledNodeStack.pop_back();
-			}
-			else {
-				waitingNode = ColorType(Random(0, 2));
-			}
+		{
+			COLORMIX_PROFILE_SCOPE(drawBoard);
+			drawBoard();
 		}
 
-		if (pickingNode) {
-			int32 laneIndex = static_cast<size_t>(Clamp<int32>(Cursor::PosF().x / oneLaneWidth, 0, gridSize.x - 1));
+		COLORMIX_PROFILE_SCOPE(drawPanels);
+		DrawLayer(panelLayer, -boardOffset());
+	}
 
-			double cursorY = Clamp(Cursor::PosF().y, fixedNodeCenterYReal(nodeIndexAtYReal(0)) + enemySpanLength, laneHeight);
+	// ポッパー・敵・固定ノード・ノードと上下の線 (盤面ローカル座標)
+	void drawBoard() const
+	{
+		const double lag = scrollLag();
 
-			if (pickingUnderLimitY) {
-				cursorY = Clamp(cursorY, fixedNodeCenterYReal(nodeIndexAtYReal(0)) + enemySpanLength, *pickingUnderLimitY + stageProgress);
+		for (auto [i, lane] : Indexed(game.nodePopers))
+		{
+			for (auto& p : lane)
+			{
+				drawNodePoper({ laneCenterX(i), interpolatedY(p.prevY, p.y) }, p.type);
 			}
+		}
 
-			bool mixable = false;
-			size_t minedIndex = 0;
-			ColorType mixedColor;
-			for (auto [i, node] : Indexed(nodesLanes[laneIndex]))
-			{
-				if (Abs(node.y - cursorY) < enemySpanLength * 0.8)
-				{
-					if (auto mixed = getMixedColor(node.type, pickingNode->type))
-					{
-						mixable = true;
-						minedIndex = i;
-						mixedColor = *mixed;
+		{
+			// 敵・固定ノード・ノードをまとめて 1 回で描く
+			const ScopedCustomShader2D shader = glossyShader ? ScopedCustomShader2D{ glossyShader } : ScopedCustomShader2D{};
 
-						break;
+			for (auto y : step(game.board.height())) {
+				for (auto x : step(game.board.width())) {
+					if (game.board.hasEnemy({ x, y })) {
+						drawEnemy({ laneCenterX(x), fixedNodeCenterYReal(y) + lag }, game.board.enemyType({ x, y }));
 					}
 				}
 			}
-
-			//fixedNode mixable check 
-			/*Point findIndex = { laneIndex,nodeIndexAtY(cursorY) - progressIndex };
-			bool gridMixable = false;
-			Point minedGridIndex = { 0,0 };
-			ColorType mixedGridColor;
-			if (fixedNodeGrid.inBounds(findIndex)) {
-				if (fixedNodeGrid[findIndex]) {
-					if (auto mixed = getMixedColor(fixedNodeGrid[findIndex]->type, *pickingNode))
-					{
-						gridMixable = true;
-						minedGridIndex = findIndex;
-						mixedGridColor = *mixed;
-					}
-				}
-			}*/
-			Vec2 prevPredictedPos = predictedPos;
-
-			Point centerIndex = { laneIndex,nodeIndexAtYReal(cursorY) };
-			if (fixedNodeGrid.inBounds(centerIndex)) {
-				if (fixedNodeGrid[centerIndex] or enemyGrid[centerIndex]) {
-
-					bool canShift = false;
-					Point shiftedIndex = { laneIndex,nodeIndexAtYReal(prevPredictedPos.y) };
-					if (fixedNodeGrid.inBounds(shiftedIndex)) {
-						if (not fixedNodeGrid[shiftedIndex] and not enemyGrid[shiftedIndex]) {
-							canShift = true;
-						}
+			for (auto y : step(game.board.height())) {
+				for (auto x : step(game.board.width())) {
+					if (game.board.hasFixed({ x, y })) {
+						drawFixedNode({ laneCenterX(x), fixedNodeCenterYReal(y) + lag }, nodeRadius(), game.board.fixedType({ x, y }));
 					}
-					if (not canShift)laneIndex = prevLaneIndex;
 				}
 			}
 
-			predictedPos = Vec2(laneIndex * oneLaneWidth + oneLaneWidth / 2, cursorY);
 
-			bool collision = false;
-			Point headIndex = { laneIndex,nodeIndexAtYReal(cursorY - enemySpanLength / 2) };
-			if (fixedNodeGrid.inBounds(headIndex)) {
-				if (fixedNodeGrid[headIndex] or enemyGrid[headIndex]) {
-					collision = true;
-				}
-			}/*
-			Point tailIndex = { laneIndex,nodeIndexAtYReal(cursorY + enemySpanLength / 2) };
-			if (fixedNodeGrid.inBounds(tailIndex)) {
-				if (fixedNodeGrid[tailIndex] or enemyGrid[tailIndex]) {
-					collision = true;
+			for (auto [i, lane] : Indexed(game.nodesLanes))
+			{
+				for (auto& node : lane)
+				{
+					drawNode({ laneCenterX(i), interpolatedY(node.prevY, node.y) }, nodeRadius(), node.type, game.time - node.monyuStartTime);
 				}
-			}*/
+			}
+		}
 
 
-			if (collision) {
 
 
-				//find down empty grid
-				headIndex.y--;
-				while (fixedNodeGrid.inBounds(headIndex)) {
-					if (not fixedNodeGrid[headIndex] and not enemyGrid[headIndex]) {
-						break;
-					}
-					headIndex.y--;
-				}
-				predictedPos = Vec2(headIndex.x * oneLaneWidth + oneLaneWidth / 2, fixedNodeCenterYReal(headIndex.y));
-			}
+		//draw upper limit
+		RectF(0, game.upperLimitY() + lag - enemySpanLength / 2 - 20, width, 20).draw(Arg::top = ColorF(0, 1, 1, 0), Arg::bottom = ColorF(0, 1, 1, 0.5));
 
-			prevLaneIndex = laneIndex;
+		//draw under limit line
+		if (game.pickingUnderLimitY)
+		{
+			Line(0, *game.pickingUnderLimitY + game.stageProgress + lag + enemySpanLength / 2, Arg::direction(width, 0)).draw(LineStyle::SquareDot.offset(game.time * 6), 2, ColorF(0, 0.8, 0.8));
+			//RectF(0, *pickingUnderLimitY + stageProgress + enemySpanLength / 2, width, 20).draw(Arg::top = ColorF(0, 1, 1, 0.5), Arg::bottom = ColorF(0, 1, 1, 0));
+		}
 
+		/*for (auto i : step(gridSize.x + 1))
+		{
+			Line(i * oneLaneWidth, 0, i * oneLaneWidth, laneHeight).draw(2, Palette::Black.withAlpha(100));
+		}*/
+	}
 
-			if (MouseL.up())
-			{
-				if (mixable) {
-					ColorNode& mixedNode = nodesLanes[laneIndex][minedIndex];
-					mixedNode.type = mixedColor;
-					mixedNode.wasEnemy += pickingNode->wasEnemy;
-					mixedNode.monyuTimer.restart();
-					AudioAsset(U"mix").playOneShot(1, 0, Random(0.9, 1.1));
-					pickingNode.reset();
-					pickingUnderLimitY.reset();
-				}
-				/*else if (gridMixable) {
-					fixedNodeGrid[minedGridIndex].reset();
-					nodesLanes[laneIndex].push_back({ fixedNodeCenterY(minedGridIndex.y + progressIndex), mixedGridColor });
-					pickingNode.reset();
-					pickingUpperLimitY.reset();
-				}*/
-				else {
-					nodesLanes[laneIndex].push_back({ predictedPos.y, pickingNode->type,pickingNode->wasEnemy });
-					pickingNode.reset();
-					pickingUnderLimitY.reset();
-					AudioAsset(U"drop").playOneShot(1, 0, Random(0.9, 1.1));
-				}
-			}
+	// 待機ノードと次のノード (盤面ローカル座標)。PlayingHud が変わったときだけレンダーテクスチャに描く
+	void drawQueue() const
+	{
+		const ScopedCustomShader2D shader = glossyShader ? ScopedCustomShader2D{ glossyShader } : ScopedCustomShader2D{};
+
+		if (game.waitingNode)
+		{
+			drawNode(pickWaitingPos, waitingNodeRadius, *game.waitingNode);
+		}
+		for (auto [i, node] : Indexed(game.nextNodes))
+		{
+			drawNode(pickWaitingPos + Vec2(-60.0 - 45.0 * i, 0), 10, node);
 		}
 	}
 
-	void draw() const
+	// 拾っているノードを落とす位置のプレビュー。HUD の待機ノードより上に描く
+	void drawPreview() const
 	{
-		Scene::Rect().draw(Palette::Beige);
+		if (not game.pickingNode)
+		{
+			return;
+		}
 
-		double translateX = (Scene::Width() - width) / 2;
+		const Transformer2D tf(Mat3x2::Translate(boardOffset()));
+		const ScopedCustomShader2D shader = glossyShader ? ScopedCustomShader2D{ glossyShader } : ScopedCustomShader2D{};
+		ScopedColorMul2D colorMul(ColorF(1, 0.5));
+		const ColorMix::Vec2 preview = game.predictDrop(latchedCursor).pos;
+		drawNode(Vec2(preview.x, preview.y), nodeRadius() * 1.15, game.pickingNode->type);
+	}
+};
 
-		Transformer2D tf(Mat3x2::Translate(translateX, upSpaceY), TransformCursor::Yes);
+// プレイ中の HUD。待機ノード・次のノードの列と、スコア・倍率・retry ボタン
+// 中身 (スコア、ノードの並び、ボタンのホバー・押下、倍率、シーンの大きさ) が変わったフレームだけレンダーテクスチャに描き直し、
+// それ以外のフレームはテクスチャを 2 枚描くだけにする
+class PlayingHud
+{
+public:
 
-		//draw border
-		constexpr double borderSize = 40;
-		for (auto i : step(static_cast<int32>(Ceil(laneHeight / borderSize))))
+	explicit PlayingHud(const Font& font)
+		: m_font{ font } {}
+
+	// 入力と盤面を見て、変わったレイヤーだけ描き直す。retry が押されたら true
+	bool update(const GameView& field)
+	{
+		const RectF retryRegion = SimpleGUI::ButtonRegion(U"retry", { 5,5 });
+		const bool retryHovered = retryRegion.mouseOver();
+
+		if (retryHovered)
 		{
-			Color c = i % 2 == 0 ? Palette::Mistyrose : Palette::Lavenderblush;
-			RectF(-20, i * borderSize, width + 40, borderSize).draw(c);
+			Cursor::RequestStyle(CursorStyle::Hand);
 		}
 
-		RectF(0, 0, width, laneHeight).drawShadow({ 0,0 }, 20);
+		QueueState queue{ .waitingNode = field.game.waitingNode, .sceneSize = Scene::Size() };
+		queue.nextCount = static_cast<int32>(Min(field.game.nextNodes.size(), queue.nextNodes.size()));
+		std::copy_n(field.game.nextNodes.begin(), queue.nextCount, queue.nextNodes.begin());
 
-		for (auto i : step(gridSize.x))
+		if (queue != m_queueState)
 		{
-			Color c = i % 2 == 0 ? ColorF(0.8, 1, 1) : ColorF(0.9, 1, 1);
-			RectF(i * oneLaneWidth, 0, oneLaneWidth, laneHeight).draw(c);
+			m_queueState = queue;
+			refreshQueue(field);
 		}
 
-		//Quad({ 0,laneHeight }, { width,laneHeight }, { width + 100,laneHeight + 200 }, {-100,laneHeight+200}).draw(ColorF(0.6, 0.8, 0.8));
+		const OverlayState overlay{
+			.score = field.game.score,
+			.timeScale = field.clock.timeScale(),
+			.paused = field.clock.isPaused(),
+			.retryHovered = retryHovered,
+			.retryPressed = (retryHovered && MouseL.pressed()),
+			.sceneSize = Scene::Size(),
+		};
 
-		for (auto [i, lane] : Indexed(nodePopers))
+		if (overlay != m_overlayState)
 		{
-			for (auto& p : lane)
-			{
-				drawNodePoper({ laneCenterX(i), p.y }, p.type);
-			}
+			m_overlayState = overlay;
+			refreshOverlay();
 		}
 
-		for (auto& p : step(enemyGrid.size())) {
-			if (auto& enemy = enemyGrid[p]) {
-				drawEnemy({ laneCenterX(p.x), fixedNodeCenterYReal(p.y) }, enemy->type);
-			}
-		}
-		for (auto& p : step(fixedNodeGrid.size())) {
-			if (auto& fixedNode = fixedNodeGrid[p]) {
-				drawFixedNode({ laneCenterX(p.x), fixedNodeCenterYReal(p.y) }, nodeRadius(), fixedNode->type);
-			}
-		}
+		return (retryHovered && MouseL.down());
+	}
 
+	// 待機ノードと次のノード。パネルより上、拾っているノードのプレビューより下に描く
+	void drawQueue() const
+	{
+		GameView::DrawLayer(m_queueLayer);
+	}
 
-		for (auto [i, lane] : Indexed(nodesLanes))
-		{
-			for (auto& node : lane)
-			{
-				drawNode({ laneCenterX(i), node.y }, nodeRadius(), node.type, node.monyuTimer);
-			}
-		}
+	// スコア・倍率・retry ボタン
+	void drawOverlay() const
+	{
+		GameView::DrawLayer(m_overlayLayer);
+	}
 
+private:
 
+	struct QueueState
+	{
+		std::optional<ColorMix::ColorType> waitingNode;
 
+		std::array<ColorMix::ColorType, 3> nextNodes{};
 
-		//draw upper limit
-		RectF(0, fixedNodeCenterYReal(nodeIndexAtYReal(0)) + enemySpanLength / 2 - 20, width, 20).draw(Arg::top = ColorF(0, 1, 1, 0), Arg::bottom = ColorF(0, 1, 1, 0.5));
+		int32 nextCount = 0;
 
-		//draw under limit line
-		if (pickingUnderLimitY)
-		{
-			Line(0, *pickingUnderLimitY + stageProgress + enemySpanLength / 2, Arg::direction(width, 0)).draw(LineStyle::SquareDot.offset(Scene::Time() * 6), 2, ColorF(0, 0.8, 0.8));
-			//RectF(0, *pickingUnderLimitY + stageProgress + enemySpanLength / 2, width, 20).draw(Arg::top = ColorF(0, 1, 1, 0.5), Arg::bottom = ColorF(0, 1, 1, 0));
-		}
+		Size sceneSize{ 0, 0 };
 
-		/*for (auto i : step(gridSize.x + 1))
-		{
-			Line(i * oneLaneWidth, 0, i * oneLaneWidth, laneHeight).draw(2, Palette::Black.withAlpha(100));
-		}*/
+		bool operator==(const QueueState&) const = default;
+	};
 
+	struct OverlayState
+	{
+		int32 score = 0;
 
+		double timeScale = 1.0;
 
+		bool paused = false;
 
+		bool retryHovered = false;
 
-		RectF(-100, -100, width + 200, 100).drawShadow({ 0,0 }, 20).draw(Palette::Blanchedalmond).drawFrame(2, Palette::Gray);
+		bool retryPressed = false;
 
-		RectF(-100, laneHeight, width + 200, 100).drawShadow({ 0,0 }, 20).draw(Palette::Blanchedalmond).drawFrame(2, Palette::Gray);
+		Size sceneSize{ 0, 0 };
 
+		bool operator==(const OverlayState&) const = default;
+	};
 
-		Circle(pickWaitingPos, waitingNodeRadius + 6).drawShadow({}, 10).draw(Palette::Beige);
-		if (waitingNode)
+	Font m_font;
+
+	// 最初の update() で必ず描くよう、まだ一度も描いていないときは none
+	Optional<QueueState> m_queueState;
+
+	Optional<OverlayState> m_overlayState;
+
+	RenderTexture m_queueLayer;
+
+	RenderTexture m_overlayLayer;
+
+	static void Prepare(RenderTexture& layer, const Size& sceneSize)
+	{
+		if (layer.size() == sceneSize)
 		{
-			drawNode(pickWaitingPos, waitingNodeRadius, *waitingNode);
+			layer.clear(ColorF(0, 0));
 		}
-		for (auto [i, node] : Indexed(nextNodes))
+		else
 		{
-			drawNode(pickWaitingPos + Vec2(-60.0 - 45.0 * i, 0), 10, node);
+			layer = RenderTexture{ sceneSize, ColorF(0, 0) };
 		}
+	}
+
+	void refreshQueue(const GameView& field)
+	{
+		Prepare(m_queueLayer, m_queueState->sceneSize);
 
+		const ScopedRenderTarget2D target{ m_queueLayer };
+		const ScopedRenderStates2D states{ GameView::LayerBlendState() };
+		const Transformer2D tf(Mat3x2::Translate(field.boardOffset()));
+		field.drawQueue();
+	}
 
-		if (pickingNode)
+	void refreshOverlay()
+	{
+		const OverlayState& overlay = *m_overlayState;
+		Prepare(m_overlayLayer, overlay.sceneSize);
+
+		const ScopedRenderTarget2D target{ m_overlayLayer };
+		const ScopedRenderStates2D states{ GameView::LayerBlendState() };
+
+		if (overlay.paused)
 		{
-			ScopedColorMul2D colorMul(ColorF(1, 0.5));
-			drawNode(predictedPos, nodeRadius() * 1.15, pickingNode->type);
+			m_font(U"PAUSE").drawAt(Scene::Center(), Palette::Black);
 		}
+		else if (overlay.timeScale != 1.0)
+		{
+			m_font(U"x{}"_fmt(overlay.timeScale)).draw(Arg::topRight = Vec2(Scene::Width() - 10, 40), Palette::Black);
+		}
+
+		m_font(U"Score: ", overlay.score).draw(Arg::topRight = Vec2(Scene::Width() - 10, 10), Palette::Black);
+
+		// 見た目はホバー・押下の状態で決まる。押されたかどうかは update() で見るので戻り値は使わない
+		SimpleGUI::Button(U"retry", { 5,5 });
 	}
 };
 
+# if COLORMIX_PROFILE
+
+// F3 で出すプロファイラの表。1 フレームあたりのフェーズごとの時間 [マイクロ秒] と、盤面の上のものの数
+void PrintProfile(const ColorMix::Profiler& profiler)
+{
+	Print << U"phase              p50     p99     max  (us, {} frames)"_fmt(profiler.frameCount());
+
+	for (size_t i = 0; i < ColorMix::ProfilePhaseCount; ++i)
+	{
+		const auto phase = ColorMix::ProfilePhase(i);
+		const ColorMix::ProfileStats stats = profiler.stats(phase);
+		Print << U"{:<15}{:>8.1f}{:>8.1f}{:>8.1f}"_fmt(Unicode::Widen(ColorMix::ProfilePhaseName(phase)), stats.p50, stats.p99, stats.max);
+	}
+
+	const ColorMix::ProfileEntityCounts latest = profiler.latestEntities();
+	const ColorMix::ProfileEntityCounts max = profiler.maxEntities();
+	Print << U"nodes {} (max {})  popers {} (max {})"_fmt(latest.nodes, max.nodes, latest.popers, max.popers);
+	Print << U"enemies {} (max {})  fixed {} (max {})"_fmt(latest.enemies, max.enemies, latest.fixedNodes, max.fixedNodes);
+}
+
+# endif
+
 enum class GameState
 {
 	title,
@@ -859,56 +1220,131 @@ enum class GameState
 
 void Main()
 {
+	// 最初に作り、ここからの時間で読み込みを計る
+	AssetLoader loader;
+
 	Scene::SetBackground(Palette::White);
-	Game field;
+	GameView field;
 
 	GameState state = GameState::title;
 
 	Window::Resize(400, 600);
 
 	Font font = SimpleGUI::GetFont();
+	PlayingHud hud{ font };
+
+	Texture logo;
+	Audio clickSound;
+	Audio finishSound;
+
+	// 優先度の高い順に積む。ロゴはすぐに出し、start は押したときの音と最初の操作で鳴る音が読めたら押せるようにする
+	// 押したあとも残りを読み終えるまではタイトルで待ち、プレイ中には読み込みが起きないようにする
+	// ゲームの効果音は GameAudio が持つ
+	loader.add([&] { logo = Texture{ U"asset/ColorMixLogo.png" }; }, false);
+	loader.add([&] { clickSound = Audio{ U"asset/SFX_UI_Button_Organic_Plastic_Thin_Negative_Back_2.wav" }; }, true);
+	const auto addSound = [&](GameAudio::Sound sound, bool neededForStart)
+	{
+		loader.add([&, sound] { field.audio.loadSource(sound); }, neededForStart);
 
-	TextureAsset::Register(U"logo", U"asset/ColorMixLogo.png");
+		for (size_t i = 0; i < GameAudio::Pitches(sound).size(); ++i)
+		{
+			loader.add([&, sound] { field.audio.makeVariant(sound); }, neededForStart);
+		}
+	};
+	addSound(GameAudio::Sound::pick, true);
+	addSound(GameAudio::Sound::drop, true);
+	addSound(GameAudio::Sound::mix, false);
+	addSound(GameAudio::Sound::pop, false);
+	addSound(GameAudio::Sound::broke, false);
+	loader.add([&] { finishSound = Audio{ U"asset/SFX_UI_Click_Designed_Scifi_Flangy_Thick_Generic_1.wav" }; }, false);
 
-	AudioAsset::Register(U"mix", U"asset/SFX_UI_Click_Designed_Liquid_Generic_Open_2.wav");
-	AudioAsset::Register(U"pick", U"asset/SFX_UI_Click_Designed_Pop_Generic_1.wav");
-	AudioAsset::Register(U"pop", U"asset/SFX_UI_Click_Organic_Pop_Thin_Generic_1.wav");
-	AudioAsset::Register(U"pick2", U"asset/SFX_UI_Click_Organic_Pop_Negative_2.wav");
-	AudioAsset::Register(U"drop", U"asset/SFX_UI_Click_Organic_Plastic_Soft_Generic_1.wav");
-	AudioAsset::Register(U"broke", U"asset/SFX_UI_Click_Designed_Metallic_Negative_1.wav");
-	AudioAsset::Register(U"click", U"asset/SFX_UI_Button_Organic_Plastic_Thin_Negative_Back_2.wav");
-	AudioAsset::Register(U"finish", U"asset/SFX_UI_Click_Designed_Scifi_Flangy_Thick_Generic_1.wav");
+	// 1 フレームで読み込みに使う時間の目安 [秒]
+	constexpr double AssetLoadBudget = 0.004;
 
+	// start を押したが、まだ読み込みが残っている
+	bool startRequested = false;
 
+# if COLORMIX_PROFILE
+	// F3: フェーズごとの時間を表示する。終了時に profile.csv に書き出す
+	bool showProfile = false;
+# endif
 
 	while (System::Update())
 	{
 		ClearPrint();
 
+		// ゲームはすべて読み終えてから始めるので、プレイ中に読み込みが起きることはない
+		if ((state == GameState::title) and (not loader.isComplete()))
+		{
+			loader.update(AssetLoadBudget);
+		}
+
 		if (state == GameState::title)
 		{
 			//font(U"Color Mix").drawAt(Scene::Center().movedBy(0, -100), Palette::Black);
-			TextureAsset(U"logo").drawAt(Scene::Center().movedBy(0, -50));
-			if (SimpleGUI::ButtonAt(U"start", Scene::CenterF().moveBy(0, 100)))
+			if (logo)
+			{
+				logo.drawAt(Scene::Center().movedBy(0, -50));
+			}
+
+			if (SimpleGUI::ButtonAt(U"start", Scene::CenterF().moveBy(0, 100), unspecified, (loader.isInteractive() and (not startRequested))))
+			{
+				startRequested = true;
+				clickSound.playOneShot();
+			}
+
+			// 読み込みはタイトルでだけ進めるので、残りを読み終えてから始める
+			if (startRequested and loader.isComplete())
 			{
+				startRequested = false;
 				field.init();
 				state = GameState::playing;
-				AudioAsset(U"click").playOneShot();
+			}
 
+			if (not loader.isComplete())
+			{
+				const RectF bar{ Scene::CenterF().movedBy(-80, 140), 160, 4 };
+				bar.draw(ColorF(0, 0.1));
+				RectF{ bar.x, bar.y, bar.w * loader.progress(), bar.h }.draw(ColorF(0, 0.5));
 			}
 		}
 		else if (state == GameState::playing)
 		{
+		# if COLORMIX_PROFILE
+			// P: 一時停止 , (カンマ): 遅く . (ピリオド): 速く
+			// スローにすると同じ tick に実時間を多く使えてしまうので、プロファイラと同じく開発用のビルドだけにする
+			if (KeyP.down())
+			{
+				field.clock.togglePaused();
+			}
+			if (KeyComma.down())
+			{
+				field.clock.setTimeScale(field.clock.timeScale() / 2);
+			}
+			if (KeyPeriod.down())
+			{
+				field.clock.setTimeScale(field.clock.timeScale() * 2);
+			}
+		# endif
+
 			field.update(Scene::DeltaTime());
 			{
+				field.latchCursor();
 				field.draw();
 			}
 
-			//font(U"Score:{}"_fmt(field.score)).draw(Arg::topRight(Scene::Rect().tl()), Palette::Black);
-			font(U"Score: ", field.score).draw(Arg::topRight = Vec2(Scene::Width() - 10, 10), Palette::Black);
+			bool retry = false;
+			{
+				COLORMIX_PROFILE_SCOPE(drawHud);
+				retry = hud.update(field);
+				hud.drawQueue();
+				field.drawPreview();
+				hud.drawOverlay();
+			}
 
-			if (SimpleGUI::Button(U"retry", { 5,5 })) {
-				AudioAsset(U"click").playOneShot();
+			if (retry) {
+				clickSound.playOneShot();
+				field.saveReplay();
 				field.init();
 				state = GameState::title;
 			}
@@ -916,31 +1352,58 @@ void Main()
 			if (field.isGameOver())
 			{
 				state = GameState::gameover;
-				AudioAsset(U"finish").playOneShot();
+				finishSound.playOneShot();
+				field.saveReplay();
 			}
 		}
 		else if (state == GameState::gameover)
 		{
 			field.draw();
+			hud.drawQueue();
+			field.drawPreview();
 			Scene::Rect().draw(ColorF(0, 0, 0, 0.5));
 
-			font(U"Score:{}"_fmt(field.score)).drawAt(Scene::Center().movedBy(0, -50), Palette::White);
+			font(U"Score:{}"_fmt(field.game.score)).drawAt(Scene::Center().movedBy(0, -50), Palette::White);
 
 			if (SimpleGUI::ButtonAt(U"retry", Scene::CenterF()))
 			{
 				field.init();
 				state = GameState::title;
-				AudioAsset(U"click").playOneShot();
+				clickSound.playOneShot();
 
 			}
 			if (SimpleGUI::ButtonAt(U"Post score on X(Twitter)", Scene::Rect().topCenter().moveBy(0, 50))) {
-				const String text = U"ColorMixでスコア{}を達成しました！\n#ColorMix #Siv3D\nhttps://comefrombottom.github.io/ColorMix-Web/"_fmt(field.score);
+				const String text = U"ColorMixでスコア{}を達成しました！\n#ColorMix #Siv3D\nhttps://comefrombottom.github.io/ColorMix-Web/"_fmt(field.game.score);
 				Twitter::OpenTweetWindow(text);
 			}
 
 		}
 
+	# if COLORMIX_PROFILE
+		ColorMix::Profiler& profiler = ColorMix::Profiler::Current();
+		profiler.setEntityCounts(ColorMix::CountEntities(field.game));
+		profiler.endFrame();
+
+		if (KeyF3.down())
+		{
+			showProfile = (not showProfile);
+		}
+
+		if (showProfile)
+		{
+			PrintProfile(profiler);
+
+			if (loader.timeToInteractive())
+			{
+				Print << U"time to interactive {:.1f} ms"_fmt(*loader.timeToInteractive() * 1e3);
+			}
+		}
+	# endif
 	}
+
+# if COLORMIX_PROFILE
+	ColorMix::Profiler::Current().writeCSV("profile.csv");
+# endif
 }
 
 //
@@ -0,0 +1,122 @@
+# include "Profiler.hpp"
+
+# if COLORMIX_PROFILE
+
+# include <algorithm>
+# include <cstdio>
+
+namespace ColorMix
+{
+	const char* ProfilePhaseName(ProfilePhase phase)
+	{
+		constexpr const char* Names[ProfilePhaseCount] = {
+			"lanePhysics",
+			"collision",
+			"popers",
+			"cascade",
+			"spawn",
+			"input",
+			"gameOver",
+			"drawBackground",
+			"drawBoard",
+			"drawPanels",
+			"drawHud",
+		};
+
+		return Names[static_cast<size_t>(phase)];
+	}
+
+	Profiler& Profiler::Current()
+	{
+		thread_local Profiler profiler;
+		return profiler;
+	}
+
+	Profiler::Profiler()
+		: m_frames(FrameCapacity) {}
+
+	void Profiler::endFrame()
+	{
+		m_frames[m_next] = m_current;
+		m_next = (m_next + 1) % FrameCapacity;
+		m_count = std::min(m_count + 1, FrameCapacity);
+		m_current = {};
+	}
+
+	ProfileStats Profiler::stats(ProfilePhase phase) const
+	{
+		if (m_count == 0)
+		{
+			return{};
+		}
+
+		std::vector<double> samples(m_count);
+
+		for (size_t i = 0; i < m_count; ++i)
+		{
+			samples[i] = frame(i).microseconds[static_cast<size_t>(phase)];
+		}
+
+		std::sort(samples.begin(), samples.end());
+
+		const auto percentile = [&](double p) { return samples[static_cast<size_t>(p * (samples.size() - 1) + 0.5)]; };
+		return{ percentile(0.5), percentile(0.99), samples.back() };
+	}
+
+	ProfileEntityCounts Profiler::latestEntities() const
+	{
+		return (m_count == 0) ? ProfileEntityCounts{} : frame(m_count - 1).entities;
+	}
+
+	ProfileEntityCounts Profiler::maxEntities() const
+	{
+		ProfileEntityCounts result;
+
+		for (size_t i = 0; i < m_count; ++i)
+		{
+			const ProfileEntityCounts& entities = frame(i).entities;
+			result.nodes = std::max(result.nodes, entities.nodes);
+			result.popers = std::max(result.popers, entities.popers);
+			result.enemies = std::max(result.enemies, entities.enemies);
+			result.fixedNodes = std::max(result.fixedNodes, entities.fixedNodes);
+		}
+
+		return result;
+	}
+
+	bool Profiler::writeCSV(const std::string& path) const
+	{
+		FILE* file = std::fopen(path.c_str(), "w");
+
+		if (not file)
+		{
+			return false;
+		}
+
+		std::fprintf(file, "frame");
+
+		for (size_t p = 0; p < ProfilePhaseCount; ++p)
+		{
+			std::fprintf(file, ",%s_us", ProfilePhaseName(ProfilePhase(p)));
+		}
+
+		std::fprintf(file, ",nodes,popers,enemies,fixed_nodes\n");
+
+		for (size_t i = 0; i < m_count; ++i)
+		{
+			const Frame& f = frame(i);
+			std::fprintf(file, "%zu", i);
+
+			for (double microseconds : f.microseconds)
+			{
+				std::fprintf(file, ",%.2f", microseconds);
+			}
+
+			std::fprintf(file, ",%d,%d,%d,%d\n", f.entities.nodes, f.entities.popers, f.entities.enemies, f.entities.fixedNodes);
+		}
+
+		return (std::fclose(file) == 0);
+	}
+}
+
+# endif
@@ -0,0 +1,180 @@
+# pragma once
+# include <array>
+# include <bit>
+# include <chrono>
+# include <cstddef>
+# include <string>
+# include <vector>
+# include "Game.hpp"
+
+// フェーズごとの処理時間を測るプロファイラ
+// 既定ではデバッグビルドだけで有効になり、リリースビルドでは COLORMIX_PROFILE_SCOPE() ごと消える
+// リリースビルドで測りたいときは COLORMIX_PROFILE=1 を定義する
+# ifndef COLORMIX_PROFILE
+#	ifdef NDEBUG
+#		define COLORMIX_PROFILE 0
+#	else
+#		define COLORMIX_PROFILE 1
+#	endif
+# endif
+
+# if COLORMIX_PROFILE
+
+namespace ColorMix
+{
+	enum class ProfilePhase : uint8
+	{
+		lanePhysics,
+		collision,
+		popers,
+		cascade,
+		spawn,
+		input,
+		gameOver,
+		drawBackground,
+		drawBoard,
+		drawPanels,
+		drawHud,
+		Count,
+	};
+
+	inline constexpr size_t ProfilePhaseCount = static_cast<size_t>(ProfilePhase::Count);
+
+	const char* ProfilePhaseName(ProfilePhase phase);
+
+	struct ProfileEntityCounts
+	{
+		int32 nodes = 0;
+
+		int32 popers = 0;
+
+		int32 enemies = 0;
+
+		int32 fixedNodes = 0;
+	};
+
+	template <class Game>
+	ProfileEntityCounts CountEntities(const Game& game)
+	{
+		ProfileEntityCounts counts;
+
+		for (int32 x = 0; x < Game::gridSize.x; ++x)
+		{
+			counts.nodes += static_cast<int32>(game.nodesLanes[x].size());
+			counts.popers += static_cast<int32>(game.nodePopers[x].size());
+			counts.enemies += std::popcount(game.board.enemyBits(x));
+			counts.fixedNodes += std::popcount(game.board.fixedBits(x));
+		}
+
+		return counts;
+	}
+
+	// 直近のフレームでの 1 フレームあたりの時間 [マイクロ秒]
+	struct ProfileStats
+	{
+		double p50 = 0.0;
+
+		double p99 = 0.0;
+
+		double max = 0.0;
+	};
+
+	// フェーズごとの時間を 1 フレーム分ずつまとめ、直近 FrameCapacity フレーム分をリングバッファに残す
+	// スレッドごとに別のもの (Current()) を使う
+	class Profiler
+	{
+	public:
+
+		static constexpr size_t FrameCapacity = 600;
+
+		static Profiler& Current();
+
+		Profiler();
+
+		void add(ProfilePhase phase, double microseconds)
+		{
+			m_current.microseconds[static_cast<size_t>(phase)] += microseconds;
+		}
+
+		void setEntityCounts(const ProfileEntityCounts& counts)
+		{
+			m_current.entities = counts;
+		}
+
+		// ここまでの分を 1 フレームとして確定する
+		void endFrame();
+
+		size_t frameCount() const
+		{
+			return m_count;
+		}
+
+		ProfileStats stats(ProfilePhase phase) const;
+
+		// 直近のフレームの数と、残っているフレームの中での最大
+		ProfileEntityCounts latestEntities() const;
+
+		ProfileEntityCounts maxEntities() const;
+
+		// 残っているフレームを古い順に 1 行ずつ書き出す
+		bool writeCSV(const std::string& path) const;
+
+	private:
+
+		struct Frame
+		{
+			std::array<double, ProfilePhaseCount> microseconds{};
+
+			ProfileEntityCounts entities;
+		};
+
+		std::vector<Frame> m_frames;
+
+		// 次に書き込む位置
+		size_t m_next = 0;
+
+		size_t m_count = 0;
+
+		Frame m_current;
+
+		const Frame& frame(size_t i) const
+		{
+			return m_frames[(m_next + FrameCapacity - m_count + i) % FrameCapacity];
+		}
+	};
+
+	// スコープを抜けるまでの時間を Profiler::Current() に足す
+	class ProfileScope
+	{
+	public:
+
+		explicit ProfileScope(ProfilePhase phase)
+			: m_phase{ phase }
+			, m_start{ std::chrono::steady_clock::now() } {}
+
+		~ProfileScope()
+		{
+			Profiler::Current().add(m_phase, std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - m_start).count());
+		}
+
+		ProfileScope(const ProfileScope&) = delete;
+
+		ProfileScope& operator=(const ProfileScope&) = delete;
+
+	private:
+
+		ProfilePhase m_phase;
+
+		std::chrono::steady_clock::time_point m_start;
+	};
+}
+
+#	define COLORMIX_PROFILE_CONCAT_(a, b) a##b
+#	define COLORMIX_PROFILE_CONCAT(a, b) COLORMIX_PROFILE_CONCAT_(a, b)
+#	define COLORMIX_PROFILE_SCOPE(phase) const ::ColorMix::ProfileScope COLORMIX_PROFILE_CONCAT(profileScope_, __LINE__){ ::ColorMix::ProfilePhase::phase }
+
+# else
+
+#	define COLORMIX_PROFILE_SCOPE(phase) ((void)0)
+
+# endif
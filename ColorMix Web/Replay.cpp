@@ -0,0 +1,427 @@
+# include <cmath>
+# include <cstdio>
+# include <cstring>
+# include "GameClock.hpp"
+# include "InputQueue.hpp"
+# include "Replay.hpp"
+
+namespace ColorMix
+{
+	namespace
+	{
+		constexpr char Magic[4] = { 'C', 'M', 'R', 'P' };
+
+		// 2: 盤面の下に抜けたポッパーを消すようにしたため、同じ入力でも finalHash が 1 と変わる
+		// 3: 敵の行をゲームとは別の乱数 (EnemyWaves) で作るようにしたため、同じ seed でも盤面が 2 と変わる
+		constexpr uint16_t Version = 3;
+
+		enum FrameFlag : uint8
+		{
+			Pressed = 1 << 0,
+			Released = 1 << 1,
+			DeltaChanged = 1 << 2,
+			CursorChanged = 1 << 3,
+		};
+
+		// delta は 1 マイクロ秒、カーソルは 1/16 ピクセル単位の整数で持つ
+		constexpr double DeltaUnit = 1'000'000.0;
+
+		constexpr double CursorUnit = 16.0;
+
+		int32 Encode(double value, double unit)
+		{
+			return static_cast<int32>(std::lround(value * unit));
+		}
+
+		double Decode(int32 value, double unit)
+		{
+			return value / unit;
+		}
+
+		// リトルエンディアンのまま書く (Web も x86 / ARM もリトルエンディアン)
+		template <class Type>
+		void Write(std::vector<uint8>& out, const Type& value)
+		{
+			const size_t offset = out.size();
+			out.resize(offset + sizeof(Type));
+			std::memcpy(out.data() + offset, &value, sizeof(Type));
+		}
+
+		class Reader
+		{
+		public:
+
+			explicit Reader(const std::vector<uint8>& data)
+				: m_data{ data } {}
+
+			template <class Type>
+			bool read(Type& value)
+			{
+				if (m_data.size() < m_offset + sizeof(Type))
+				{
+					return false;
+				}
+
+				std::memcpy(&value, m_data.data() + m_offset, sizeof(Type));
+				m_offset += sizeof(Type);
+				return true;
+			}
+
+		private:
+
+			const std::vector<uint8>& m_data;
+
+			size_t m_offset = 0;
+		};
+
+		// FNV-1a
+		class Hasher
+		{
+		public:
+
+			template <class Type>
+			void add(const Type& value)
+			{
+				uint8 bytes[sizeof(Type)];
+				std::memcpy(bytes, &value, sizeof(Type));
+
+				for (uint8 byte : bytes)
+				{
+					m_hash = (m_hash ^ byte) * 0x100000001B3ULL;
+				}
+			}
+
+			uint64 value() const
+			{
+				return m_hash;
+			}
+
+		private:
+
+			uint64 m_hash = 0xCBF29CE484222325ULL;
+		};
+	}
+
+	ReplayFrame Replay::Quantize(double delta, const TickInput& input)
+	{
+		ReplayFrame frame;
+		frame.delta = Decode(Encode(delta, DeltaUnit), DeltaUnit);
+		frame.input.cursor = { Decode(Encode(input.cursor.x, CursorUnit), CursorUnit), Decode(Encode(input.cursor.y, CursorUnit), CursorUnit) };
+		frame.input.pressed = input.pressed;
+		frame.input.released = input.released;
+		return frame;
+	}
+
+	const ReplayFrame& Replay::record(double delta, const TickInput& input)
+	{
+		frames.push_back(Quantize(delta, input));
+		return frames.back();
+	}
+
+	void Replay::finish(const Game& game)
+	{
+		finalScore = game.score;
+		finalHash = StateHash(game);
+	}
+
+	std::vector<uint8> Replay::serialize() const
+	{
+		std::vector<uint8> out;
+		out.reserve(32 + frames.size() * 2);
+
+		Write(out, Magic);
+		Write(out, Version);
+		Write(out, seed);
+		Write(out, finalScore);
+		Write(out, finalHash);
+		Write(out, static_cast<uint32>(frames.size()));
+
+		ReplayFrame prev;
+
+		for (const auto& frame : frames)
+		{
+			uint8 flags = 0;
+			flags |= frame.input.pressed ? Pressed : 0;
+			flags |= frame.input.released ? Released : 0;
+			flags |= (frame.delta != prev.delta) ? DeltaChanged : 0;
+			flags |= ((frame.input.cursor.x != prev.input.cursor.x) or (frame.input.cursor.y != prev.input.cursor.y)) ? CursorChanged : 0;
+			Write(out, flags);
+
+			if (flags & DeltaChanged)
+			{
+				Write(out, Encode(frame.delta, DeltaUnit));
+			}
+
+			if (flags & CursorChanged)
+			{
+				Write(out, Encode(frame.input.cursor.x, CursorUnit));
+				Write(out, Encode(frame.input.cursor.y, CursorUnit));
+			}
+
+			prev = frame;
+		}
+
+		return out;
+	}
+
+	std::optional<Replay> Replay::Deserialize(const std::vector<uint8>& data)
+	{
+		Reader reader{ data };
+
+		char magic[4];
+		uint16_t version = 0;
+		uint32 frameCount = 0;
+		Replay replay;
+
+		if (not (reader.read(magic) and (std::memcmp(magic, Magic, sizeof(Magic)) == 0)
+			and reader.read(version) and (version == Version)
+			and reader.read(replay.seed) and reader.read(replay.finalScore) and reader.read(replay.finalHash)
+			and reader.read(frameCount)))
+		{
+			return std::nullopt;
+		}
+
+		// 1 tick は少なくとも 1 バイトなので、壊れた frameCount で大きく確保しない
+		if (data.size() < frameCount)
+		{
+			return std::nullopt;
+		}
+
+		replay.frames.reserve(frameCount);
+
+		ReplayFrame prev;
+
+		for (uint32 i = 0; i < frameCount; ++i)
+		{
+			uint8 flags = 0;
+
+			if (not reader.read(flags))
+			{
+				return std::nullopt;
+			}
+
+			ReplayFrame frame = prev;
+			frame.input.pressed = (flags & Pressed);
+			frame.input.released = (flags & Released);
+
+			if (flags & DeltaChanged)
+			{
+				int32 delta;
+
+				if (not reader.read(delta))
+				{
+					return std::nullopt;
+				}
+
+				frame.delta = Decode(delta, DeltaUnit);
+			}
+
+			if (flags & CursorChanged)
+			{
+				int32 x, y;
+
+				if (not (reader.read(x) and reader.read(y)))
+				{
+					return std::nullopt;
+				}
+
+				frame.input.cursor = { Decode(x, CursorUnit), Decode(y, CursorUnit) };
+			}
+
+			replay.frames.push_back(frame);
+			prev = frame;
+		}
+
+		return replay;
+	}
+
+	bool Replay::save(const std::string& path) const
+	{
+		const std::vector<uint8> data = serialize();
+
+		FILE* file = std::fopen(path.c_str(), "wb");
+
+		if (not file)
+		{
+			return false;
+		}
+
+		const bool ok = (std::fwrite(data.data(), 1, data.size(), file) == data.size());
+		return (std::fclose(file) == 0) and ok;
+	}
+
+	std::optional<Replay> Replay::Load(const std::string& path)
+	{
+		FILE* file = std::fopen(path.c_str(), "rb");
+
+		if (not file)
+		{
+			return std::nullopt;
+		}
+
+		std::vector<uint8> data;
+		uint8 buffer[4096];
+
+		while (const size_t size = std::fread(buffer, 1, sizeof(buffer), file))
+		{
+			data.insert(data.end(), buffer, buffer + size);
+		}
+
+		std::fclose(file);
+		return Deserialize(data);
+	}
+
+	uint64 StateHash(const Game& game)
+	{
+		Hasher hasher;
+
+		hasher.add(game.score);
+		hasher.add(game.time);
+		hasher.add(game.stageProgress);
+		hasher.add(game.enemySpeed);
+		hasher.add(game.progressIndex);
+		hasher.add(game.enemySetIndexY);
+
+		for (int32 x = 0; x < game.board.width(); ++x)
+		{
+			hasher.add(game.board.enemyBits(x));
+			hasher.add(game.board.fixedBits(x));
+
+			for (int32 y = 0; y < game.board.height(); ++y)
+			{
+				if (game.board.hasEnemy({ x, y }))
+				{
+					hasher.add(game.board.enemyType({ x, y }));
+				}
+
+				if (game.board.hasFixed({ x, y }))
+				{
+					hasher.add(game.board.fixedType({ x, y }));
+					hasher.add(game.board.fixedWasEnemy({ x, y }));
+				}
+			}
+		}
+
+		for (const auto& lane : game.nodesLanes)
+		{
+			hasher.add(static_cast<uint32>(lane.size()));
+
+			for (const auto& node : lane)
+			{
+				hasher.add(node.y);
+				hasher.add(node.type);
+				hasher.add(node.wasEnemy);
+			}
+		}
+
+		for (const auto& lane : game.nodePopers)
+		{
+			hasher.add(static_cast<uint32>(lane.size()));
+
+			for (const auto& p : lane)
+			{
+				hasher.add(p.y);
+				hasher.add(p.speed);
+				hasher.add(p.count);
+			}
+		}
+
+		hasher.add(game.waitingNode.value_or(ColorType::black));
+		hasher.add(game.waitingNode.has_value());
+
+		for (const auto& node : game.nextNodes)
+		{
+			hasher.add(node);
+		}
+
+		hasher.add(game.pickingNode.has_value());
+
+		if (game.pickingNode)
+		{
+			hasher.add(game.pickingNode->type);
+			hasher.add(game.pickingNode->wasEnemy);
+		}
+
+		return hasher.value();
+	}
+
+	ReplayResult Play(const Replay& replay, Game& game)
+	{
+		game.init(replay.seed);
+
+		for (const auto& frame : replay.frames)
+		{
+			game.update(frame.delta, frame.input);
+		}
+
+		ReplayResult result;
+		result.score = game.score;
+		result.ticks = static_cast<long long>(replay.frames.size());
+		result.hash = StateHash(game);
+		result.matches = (result.score == replay.finalScore) and (result.hash == replay.finalHash);
+		return result;
+	}
+
+	ReplayResult Verify(const Replay& replay, Game& game, long long maxTicks)
+	{
+		const double step = Replay::Quantize(TickDelta, {}).delta;
+		ReplayResult result;
+
+		long long steps = 0;
+
+		for (const auto& frame : replay.frames)
+		{
+			steps += (frame.delta != 0.0);
+		}
+
+		// delta が 0 の frame も流すので、刻みの数だけでなく frame の数でも上限を掛ける
+		const long long frames = static_cast<long long>(replay.frames.size());
+
+		if ((maxTicks < steps) or ((maxTicks * static_cast<long long>(InputQueue::MaxInputsPerTick)) < frames))
+		{
+			result.violation = ReplayViolation::tooLong;
+			return result;
+		}
+
+		game.init(replay.seed);
+
+		// 今の刻みに入っている frame の数。最初の frame は刻みを進めるものでなければならない
+		size_t inputsInTick = InputQueue::MaxInputsPerTick;
+
+		for (const auto& frame : replay.frames)
+		{
+			if ((frame.delta != step) and (frame.delta != 0.0))
+			{
+				result.violation = ReplayViolation::invalidDelta;
+				break;
+			}
+
+			inputsInTick = (frame.delta != 0.0) ? 1 : (inputsInTick + 1);
+
+			if (InputQueue::MaxInputsPerTick < inputsInTick)
+			{
+				result.violation = ReplayViolation::tooManyInputs;
+				break;
+			}
+
+			if (game.isGameOver())
+			{
+				result.violation = ReplayViolation::inputAfterGameOver;
+				break;
+			}
+
+			game.update(frame.delta, frame.input);
+			++result.ticks;
+		}
+
+		if ((result.violation == ReplayViolation::none) and (not game.isGameOver()) and (steps < maxTicks))
+		{
+			result.violation = ReplayViolation::unfinished;
+		}
+
+		result.score = game.score;
+		result.hash = StateHash(game);
+		result.matches = (result.violation == ReplayViolation::none) and (result.score == replay.finalScore) and (result.hash == replay.finalHash);
+		return result;
+	}
+}
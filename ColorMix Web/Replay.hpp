@@ -0,0 +1,97 @@
+# pragma once
+# include <optional>
+# include <string>
+# include <vector>
+# include "Game.hpp"
+
+namespace ColorMix
+{
+	// 1 tick 分の記録
+	struct ReplayFrame
+	{
+		double delta = 0.0;
+
+		TickInput input;
+	};
+
+	// 1 ゲーム分の seed と、update() に渡した delta と入力の列
+	// 同じ seed で init() して frames を順に update() に渡せば、同じゲームがそのまま再現される
+	struct Replay
+	{
+		uint64 seed = 0;
+
+		std::vector<ReplayFrame> frames;
+
+		// 記録を終えたときのスコアと StateHash()。再生結果の確認に使う
+		int32 finalScore = 0;
+
+		uint64 finalHash = 0;
+
+		// ファイルに書ける精度 (delta は 1 マイクロ秒、カーソルは 1/16 ピクセル) に丸めた 1 tick
+		static ReplayFrame Quantize(double delta, const TickInput& input);
+
+		// Quantize() して追加する。記録中は戻り値のほうを update() に渡す
+		const ReplayFrame& record(double delta, const TickInput& input);
+
+		// 記録を終える
+		void finish(const Game& game);
+
+		// delta やカーソルが前の tick と同じならフラグだけを書く
+		std::vector<uint8> serialize() const;
+
+		static std::optional<Replay> Deserialize(const std::vector<uint8>& data);
+
+		bool save(const std::string& path) const;
+
+		static std::optional<Replay> Load(const std::string& path);
+	};
+
+	// 状態のハッシュ。同じ入力で同じ状態になったかの確認用
+	uint64 StateHash(const Game& game);
+
+	// 投稿されたリプレイとして認めない理由
+	enum class ReplayViolation : uint8
+	{
+		none,
+
+		// 固定の刻み (TickDelta) でも 0 でもない delta がある
+		invalidDelta,
+
+		// 1 つの刻みに InputQueue::MaxInputsPerTick より多くの入力がある (刻みを進める frame より前に delta が 0 の frame がある場合も)
+		tooManyInputs,
+
+		// ゲームオーバーのあとにも frame がある
+		inputAfterGameOver,
+
+		// ゲームオーバーにも maxTicks にも届かずに終わっている
+		unfinished,
+
+		// 刻みが maxTicks より多いか、frame が maxTicks * InputQueue::MaxInputsPerTick より多い (再生しない)
+		tooLong,
+	};
+
+	struct ReplayResult
+	{
+		int32 score = 0;
+
+		long long ticks = 0;
+
+		uint64 hash = 0;
+
+		// 記録時のスコアとハッシュに一致したか (Verify() では violation がないことも含む)
+		bool matches = false;
+
+		ReplayViolation violation = ReplayViolation::none;
+	};
+
+	// 描画なしで最後まで流す
+	ReplayResult Play(const Replay& replay, Game& game);
+
+	// 投稿されたリプレイの確認用。Play() と同じく流すが、Web 版が記録しえない frame があればそこで止める
+	// - delta は TickDelta を丸めたものか、同じ刻みの 2 つ目からの入力の 0
+	// - 1 つの刻みの入力は InputQueue::MaxInputsPerTick 個まで
+	// - ゲームオーバーのあとに frame がない
+	// - ゲームオーバーか、maxTicks 刻み目で終わっている
+	// ticks は実際に流した frame の数
+	ReplayResult Verify(const Replay& replay, Game& game, long long maxTicks);
+}
@@ -0,0 +1,155 @@
+#version 300 es
+
+//
+//	ColorMix: ノード・固定ノード・敵を 1 枚の四角形で描く
+//
+//	Color.r : 色相 (0.0 - 1.0)
+//	Color.g : 1.0 なら有彩色、0.0 なら黒
+//	Color.a : 全体の不透明度
+//	UV.x    : 種類 * 4 + 1 から 種類 * 4 + 2 (0: ノード, 1: 固定ノード, 2: 敵)
+//	UV.y    : 0.0 - 1.0
+//
+//	四角形の半分の大きさはノード半径の GlossyExtent 倍 (Main.cpp と合わせる)
+//
+
+precision mediump float;
+
+//
+//	PSInput
+//
+in vec4 Color;
+
+// UV.x は敵で 10 近くまであり、mediump (16 bit) では p が 0.008 刻み (半ピクセルほど) になって縁がちらつくので highp で受ける
+in highp vec2 UV;
+
+//
+//	PSOutput
+//
+layout(location = 0) out vec4 FragColor;
+
+//
+//	Constant Buffer
+//
+layout(std140) uniform PSConstants2D
+{
+	vec4 g_colorAdd;
+	vec4 g_sdfParam;
+	vec4 g_sdfOutlineColor;
+	vec4 g_sdfShadowColor;
+};
+
+const float GlossyExtent = 1.25;
+
+//
+//	Functions
+//
+vec3 HSVToRGB(float h, float s, float v)
+{
+	vec3 rgb = clamp(abs(mod(h * 6.0 + vec3(0.0, 4.0, 2.0), 6.0) - 3.0) - 1.0, 0.0, 1.0);
+	return v * mix(vec3(1.0), rgb, s);
+}
+
+float SDCircle(vec2 p, vec2 center, float r)
+{
+	return length(p - center) - r;
+}
+
+float SDEllipse(vec2 p, vec2 center, vec2 radii)
+{
+	// 近似: 単位円に直した距離を短い方の半径で戻す
+	vec2 q = (p - center) / radii;
+	return (length(q) - 1.0) * min(radii.x, radii.y);
+}
+
+float SDRoundRect(vec2 p, vec2 center, vec2 halfSize, float r)
+{
+	vec2 q = abs(p - center) - halfSize + r;
+	return length(max(q, 0.0)) + min(max(q.x, q.y), 0.0) - r;
+}
+
+vec2 Rotate(vec2 p, float angle)
+{
+	float s = sin(angle);
+	float c = cos(angle);
+	return vec2(c * p.x - s * p.y, s * p.x + c * p.y);
+}
+
+// アンチエイリアスした塗りつぶし
+float Fill(float d, float aa)
+{
+	return clamp(0.5 - d / aa, 0.0, 1.0);
+}
+
+// drawShadow 相当のぼかし
+float Soft(float d, float blur)
+{
+	return 1.0 - smoothstep(-blur * 0.5, blur * 0.5, d);
+}
+
+// 内側に thickness の幅の枠
+float Frame(float d, float thickness, float aa)
+{
+	return Fill(d, aa) * (1.0 - Fill(d + thickness, aa));
+}
+
+// 乗算済みアルファで重ねる
+vec4 Over(vec4 dst, vec3 color, float alpha)
+{
+	return vec4(color * alpha, alpha) + dst * (1.0 - alpha);
+}
+
+void main()
+{
+	highp float kind = floor(UV.x / 4.0);
+	highp vec2 p = (vec2(UV.x - kind * 4.0 - 1.0, UV.y) * 2.0 - 1.0) * GlossyExtent;
+	float aa = max(fwidth(p.x), fwidth(p.y));
+
+	bool colored = (0.5 < Color.g);
+	vec3 bodyColor = colored ? HSVToRGB(Color.r, 0.8, 1.0) : vec3(0.2);
+	vec3 shadeColor = colored ? HSVToRGB(Color.r, 0.8, 0.9) : vec3(0.0);
+	float shadeAlpha = colored ? 1.0 : 0.1;
+	vec3 shadowColor = colored ? HSVToRGB(Color.r, 1.0, 1.0) : vec3(0.2);
+	vec3 frameColor = colored ? HSVToRGB(Color.r, 1.0, 0.9) : vec3(0.0);
+
+	// 枠の太さ 4px をノード半径の単位に直す
+	float frameThickness = 4.0 * aa;
+
+	vec4 result = vec4(0.0);
+
+	if (kind < 1.5)
+	{
+		float body = SDCircle(p, vec2(0.0), 1.0);
+
+		// 有彩色の固定ノードは影を落とさない
+		if ((kind < 0.5) || (!colored))
+		{
+			result = Over(result, shadowColor, 0.7 * Soft(body, 0.3));
+		}
+
+		result = Over(result, bodyColor, Fill(body, aa));
+		result = Over(result, shadeColor, shadeAlpha * Soft(SDEllipse(p, vec2(0.0, 0.45), vec2(0.65, 0.52)), 0.2));
+
+		if (0.5 < kind)
+		{
+			result = Over(result, frameColor, Frame(body, frameThickness, aa));
+		}
+
+		result = Over(result, vec3(0.5), 0.1 * Soft(SDCircle(p, vec2(0.0), 0.5), 0.2));
+		result = Over(result, vec3(1.0), 0.4 * Fill(SDEllipse(Rotate(p, radians(40.0)), vec2(0.0, -0.7), vec2(0.4, 0.2)), aa));
+		result = Over(result, vec3(1.0), 0.4 * Fill(SDEllipse(Rotate(p, radians(-20.0)), vec2(0.0, -0.8), vec2(0.2, 0.15)), aa));
+	}
+	else
+	{
+		float body = SDRoundRect(p, vec2(0.0), vec2(1.0), 0.35);
+
+		result = Over(result, shadowColor, 0.7 * Soft(body, 0.35));
+		result = Over(result, bodyColor, Fill(body, aa));
+		result = Over(result, shadeColor, shadeAlpha * Fill(SDRoundRect(p, vec2(0.0, 0.4), vec2(0.8, 0.4), 0.2), aa));
+		result = Over(result, vec3(1.0), 0.4 * Fill(SDRoundRect(p, vec2(0.0, -0.65), vec2(0.8, 0.15), 0.15), aa));
+		result = Over(result, frameColor, Frame(body, frameThickness, aa));
+	}
+
+	result *= Color.a;
+
+	FragColor = vec4(result.rgb / max(result.a, 0.0001), result.a) + g_colorAdd;
+}
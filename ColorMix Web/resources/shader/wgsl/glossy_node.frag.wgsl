@@ -0,0 +1,133 @@
+//
+//	ColorMix: ノード・固定ノード・敵を 1 枚の四角形で描く
+//	(essl/glossy_node.frag と同じ内容)
+//
+
+//
+//	Constant Buffer
+//
+struct PSConstants2DStruct
+{
+	colorAdd: vec4<f32>,
+	sdfParam: vec4<f32>,
+	sdfOutlineColor: vec4<f32>,
+	sdfShadowColor: vec4<f32>,
+	unused: vec4<f32>,
+};
+
+@group(1) @binding(0)
+var<uniform> PSConstants2D: PSConstants2DStruct;
+
+const GlossyExtent: f32 = 1.25;
+
+//
+//	Functions
+//
+fn HSVToRGB(h: f32, s: f32, v: f32) -> vec3<f32>
+{
+	let rgb = clamp(abs((h * 6.0 + vec3<f32>(0.0, 4.0, 2.0)) % vec3<f32>(6.0) - 3.0) - 1.0, vec3<f32>(0.0), vec3<f32>(1.0));
+	return v * mix(vec3<f32>(1.0), rgb, s);
+}
+
+fn SDCircle(p: vec2<f32>, center: vec2<f32>, r: f32) -> f32
+{
+	return length(p - center) - r;
+}
+
+fn SDEllipse(p: vec2<f32>, center: vec2<f32>, radii: vec2<f32>) -> f32
+{
+	let q = (p - center) / radii;
+	return (length(q) - 1.0) * min(radii.x, radii.y);
+}
+
+fn SDRoundRect(p: vec2<f32>, center: vec2<f32>, halfSize: vec2<f32>, r: f32) -> f32
+{
+	let q = abs(p - center) - halfSize + r;
+	return length(max(q, vec2<f32>(0.0))) + min(max(q.x, q.y), 0.0) - r;
+}
+
+fn Rotate(p: vec2<f32>, angle: f32) -> vec2<f32>
+{
+	let s = sin(angle);
+	let c = cos(angle);
+	return vec2<f32>(c * p.x - s * p.y, s * p.x + c * p.y);
+}
+
+fn Fill(d: f32, aa: f32) -> f32
+{
+	return clamp(0.5 - d / aa, 0.0, 1.0);
+}
+
+fn Soft(d: f32, blur: f32) -> f32
+{
+	return 1.0 - smoothstep(-blur * 0.5, blur * 0.5, d);
+}
+
+fn Frame(d: f32, thickness: f32, aa: f32) -> f32
+{
+	return Fill(d, aa) * (1.0 - Fill(d + thickness, aa));
+}
+
+fn Over(dst: vec4<f32>, color: vec3<f32>, alpha: f32) -> vec4<f32>
+{
+	return vec4<f32>(color * alpha, alpha) + dst * (1.0 - alpha);
+}
+
+@fragment
+fn main(
+	@builtin(position) Position: vec4<f32>,
+	@location(0) Color: vec4<f32>,
+	@location(1) UV: vec2<f32>
+) -> @location(0) vec4<f32>
+{
+	let kind = floor(UV.x / 4.0);
+	let p = (vec2<f32>(UV.x - kind * 4.0 - 1.0, UV.y) * 2.0 - 1.0) * GlossyExtent;
+	let aa = max(fwidth(p.x), fwidth(p.y));
+
+	let colored = (0.5 < Color.g);
+	let bodyColor = select(vec3<f32>(0.2), HSVToRGB(Color.r, 0.8, 1.0), colored);
+	let shadeColor = select(vec3<f32>(0.0), HSVToRGB(Color.r, 0.8, 0.9), colored);
+	let shadeAlpha = select(0.1, 1.0, colored);
+	let shadowColor = select(vec3<f32>(0.2), HSVToRGB(Color.r, 1.0, 1.0), colored);
+	let frameColor = select(vec3<f32>(0.0), HSVToRGB(Color.r, 1.0, 0.9), colored);
+
+	let frameThickness = 4.0 * aa;
+
+	var result = vec4<f32>(0.0);
+
+	if (kind < 1.5)
+	{
+		let body = SDCircle(p, vec2<f32>(0.0), 1.0);
+
+		if ((kind < 0.5) || !colored)
+		{
+			result = Over(result, shadowColor, 0.7 * Soft(body, 0.3));
+		}
+
+		result = Over(result, bodyColor, Fill(body, aa));
+		result = Over(result, shadeColor, shadeAlpha * Soft(SDEllipse(p, vec2<f32>(0.0, 0.45), vec2<f32>(0.65, 0.52)), 0.2));
+
+		if (0.5 < kind)
+		{
+			result = Over(result, frameColor, Frame(body, frameThickness, aa));
+		}
+
+		result = Over(result, vec3<f32>(0.5), 0.1 * Soft(SDCircle(p, vec2<f32>(0.0), 0.5), 0.2));
+		result = Over(result, vec3<f32>(1.0), 0.4 * Fill(SDEllipse(Rotate(p, radians(40.0)), vec2<f32>(0.0, -0.7), vec2<f32>(0.4, 0.2)), aa));
+		result = Over(result, vec3<f32>(1.0), 0.4 * Fill(SDEllipse(Rotate(p, radians(-20.0)), vec2<f32>(0.0, -0.8), vec2<f32>(0.2, 0.15)), aa));
+	}
+	else
+	{
+		let body = SDRoundRect(p, vec2<f32>(0.0), vec2<f32>(1.0), 0.35);
+
+		result = Over(result, shadowColor, 0.7 * Soft(body, 0.35));
+		result = Over(result, bodyColor, Fill(body, aa));
+		result = Over(result, shadeColor, shadeAlpha * Fill(SDRoundRect(p, vec2<f32>(0.0, 0.4), vec2<f32>(0.8, 0.4), 0.2), aa));
+		result = Over(result, vec3<f32>(1.0), 0.4 * Fill(SDRoundRect(p, vec2<f32>(0.0, -0.65), vec2<f32>(0.8, 0.15), 0.15), aa));
+		result = Over(result, frameColor, Frame(body, frameThickness, aa));
+	}
+
+	result = result * Color.a;
+
+	return vec4<f32>(result.rgb / max(result.a, 0.0001), result.a) + PSConstants2D.colorAdd;
+}
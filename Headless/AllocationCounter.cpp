@@ -0,0 +1,51 @@
+# include <cstdlib>
+# include <new>
+# include "AllocationCounter.hpp"
+
+namespace
+{
+	// 計測区間中のヒープ確保回数
+	size_t g_allocationCount = 0;
+
+	bool g_countAllocations = false;
+}
+
+void* operator new(std::size_t size)
+{
+	if (g_countAllocations)
+	{
+		++g_allocationCount;
+	}
+
+	if (void* p = std::malloc(size ? size : 1))
+	{
+		return p;
+	}
+
+	throw std::bad_alloc{};
+}
+
+void operator delete(void* p) noexcept
+{
+	std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+	std::free(p);
+}
+
+namespace ColorMix::AllocationCounter
+{
+	void start()
+	{
+		g_allocationCount = 0;
+		g_countAllocations = true;
+	}
+
+	size_t stop()
+	{
+		g_countAllocations = false;
+		return g_allocationCount;
+	}
+}
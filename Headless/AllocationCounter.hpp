@@ -0,0 +1,15 @@
+# pragma once
+# include <cstddef>
+
+namespace ColorMix
+{
+	// グローバルの operator new を置き換えて、start() から stop() までのヒープ確保を数える
+	// AllocationCounter.cpp をリンクした実行ファイルだけが対象になる。シングルスレッドでの計測用
+	namespace AllocationCounter
+	{
+		void start();
+
+		// start() からの確保回数
+		size_t stop();
+	}
+}
@@ -0,0 +1,305 @@
+# include <chrono>
+# include <cstdio>
+# include <cstdlib>
+# include <cstring>
+# include <functional>
+# include <string>
+# include <utility>
+# include <vector>
+# include "AllocationCounter.hpp"
+# include "Game.hpp"
+# include "GameClock.hpp"
+
+// ゲームロジックのホットパスのマイクロベンチマーク
+//
+// ColorMixBenchmark [--filter TEXT] [--min-time SECONDS] [--json PATH]
+//
+// 結果は表として標準出力に、JSON として --json のパス (既定: benchmark.json) に書き出す
+
+namespace
+{
+	using namespace ColorMix;
+
+	using Clock = std::chrono::steady_clock;
+
+	volatile int64_t g_sink = 0;
+
+	struct BenchmarkResult
+	{
+		std::string name;
+		double nsPerOp = 0.0;
+		double allocationsPerOp = 0.0;
+		long long ops = 0;
+	};
+
+	struct BenchmarkOptions
+	{
+		std::string filter;
+		double minTime = 0.25;
+	};
+
+	// setup で盤面を作り直し (計測外)、body を opsPerRound 回実行する (計測内) のを minTime 秒分繰り返す
+	BenchmarkResult Run(const std::string& name, const BenchmarkOptions& options, const Game& prototype, int32 opsPerRound, const std::function<void(Game&)>& body)
+	{
+		BenchmarkResult result{ name };
+
+		double elapsed = 0.0;
+		size_t allocations = 0;
+
+		// コンストラクタで確保した領域に代入して使い回す (コピー構築だと容量が要素数ぶんしか残らない)
+		Game game;
+
+		while (elapsed < options.minTime)
+		{
+			game = prototype;
+
+			AllocationCounter::start();
+			const auto start = Clock::now();
+
+			for (int32 i = 0; i < opsPerRound; ++i)
+			{
+				body(game);
+			}
+
+			const auto end = Clock::now();
+			allocations += AllocationCounter::stop();
+
+			elapsed += std::chrono::duration<double>(end - start).count();
+			result.ops += opsPerRound;
+		}
+
+		result.nsPerOp = elapsed * 1e9 / result.ops;
+		result.allocationsPerOp = static_cast<double>(allocations) / result.ops;
+		return result;
+	}
+
+	Game EmptyBoard()
+	{
+		Game game{ 1 };
+		game.update(TickDelta, {});
+		return game;
+	}
+
+	// 各レーンに count 個の ColorNode を、盤面の下から間隔を空けて並べる
+	Game LaneNodesBoard(int32 count)
+	{
+		Game game = EmptyBoard();
+
+		for (auto& lane : game.nodesLanes)
+		{
+			for (int32 i = 0; i < count; ++i)
+			{
+				lane.push_back({ Game::laneHeight + i * Game::enemySpanLength, ColorType(i % 3) });
+			}
+		}
+
+		return game;
+	}
+
+	void FillEnemies(Game& game)
+	{
+		for (int32 y = 0; y < Game::gridSize.y; ++y)
+		{
+			for (int32 x = 0; x < Game::gridSize.x; ++x)
+			{
+				game.board.setEnemy({ x, y }, ColorType(game.random.range(0, 6)));
+			}
+		}
+	}
+
+	Game FullEnemyBoard()
+	{
+		Game game = EmptyBoard();
+		FillEnemies(game);
+		return game;
+	}
+
+	// 敵の下に固定ノードを積み、各レーンのポッパーが敵を押し出して連鎖的にノードが解放される盤面
+	Game ChainBoard()
+	{
+		Game game = EmptyBoard();
+		const int32 top = Game::gridSize.y - 1;
+
+		for (int32 x = 0; x < Game::gridSize.x; ++x)
+		{
+			for (int32 y = 0; y < top; ++y)
+			{
+				if (y % 2)
+				{
+					game.board.setEnemy({ x, y }, ColorType::black);
+				}
+				else
+				{
+					game.board.setFixed({ x, y }, ColorType::black, 1);
+				}
+			}
+
+			game.nodePopers[x].push_back({ game.fixedNodeCenterYReal(top), ColorType::black });
+		}
+
+		return game;
+	}
+
+	// 1 列まるごと固定ノードが積まれた盤面
+	Game FixedColumnBoard()
+	{
+		Game game = EmptyBoard();
+
+		for (int32 x = 0; x < Game::gridSize.x; ++x)
+		{
+			for (int32 y = 0; y < Game::gridSize.y; ++y)
+			{
+				game.board.setFixed({ x, y }, ColorType::red, 0);
+			}
+		}
+
+		return game;
+	}
+
+	void Print(const BenchmarkResult& result)
+	{
+		std::printf("%-40s %12.1f ns/op %10.2f allocs/op %12lld ops\n", result.name.c_str(), result.nsPerOp, result.allocationsPerOp, result.ops);
+	}
+
+	bool WriteJSON(const char* path, const std::vector<BenchmarkResult>& results)
+	{
+		FILE* file = std::fopen(path, "w");
+
+		if (not file)
+		{
+			return false;
+		}
+
+		std::fprintf(file, "[\n");
+
+		for (size_t i = 0; i < results.size(); ++i)
+		{
+			const auto& result = results[i];
+			std::fprintf(file, "  { \"name\": \"%s\", \"ns_per_op\": %.3f, \"allocations_per_op\": %.3f, \"ops\": %lld }%s\n",
+				result.name.c_str(), result.nsPerOp, result.allocationsPerOp, result.ops, (i + 1 < results.size()) ? "," : "");
+		}
+
+		std::fprintf(file, "]\n");
+		std::fclose(file);
+		return true;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	BenchmarkOptions options;
+	const char* jsonPath = "benchmark.json";
+
+	for (int i = 1; i + 1 < argc; i += 2)
+	{
+		if (std::strcmp(argv[i], "--filter") == 0)
+		{
+			options.filter = argv[i + 1];
+		}
+		else if (std::strcmp(argv[i], "--min-time") == 0)
+		{
+			options.minTime = std::atof(argv[i + 1]);
+		}
+		else if (std::strcmp(argv[i], "--json") == 0)
+		{
+			jsonPath = argv[i + 1];
+		}
+		else
+		{
+			std::fprintf(stderr, "unknown option: %s\n", argv[i]);
+			return 1;
+		}
+	}
+
+	std::vector<BenchmarkResult> results;
+
+	const auto bench = [&](const std::string& name, const Game& prototype, int32 opsPerRound, const std::function<void(Game&)>& body)
+	{
+		if (name.find(options.filter) == std::string::npos)
+		{
+			return;
+		}
+
+		results.push_back(Run(name, options, prototype, opsPerRound, body));
+		Print(results.back());
+	};
+
+	// ゲームと同じ TickDelta で進める。1 回分の tick 数は 1/60 秒刻みだったころと同じゲーム時間になるようにしてある
+	const auto tick = [](Game& game) { game.update(TickDelta, {}); };
+
+	bench("update/empty", EmptyBoard(), 120, tick);
+	for (int32 count : { 10, 50, 200 })
+	{
+		bench("update/lane_nodes_" + std::to_string(count), LaneNodesBoard(count), 20, tick);
+	}
+	bench("update/full_enemy_grid", FullEnemyBoard(), 120, tick);
+	bench("update/chain_cascade", ChainBoard(), 60, tick);
+
+	bench("progressGrid", FullEnemyBoard(), Game::gridSize.y, [](Game& game) { game.progressGrid(); });
+
+	bench("resolveCascade/full_column", FixedColumnBoard(), 1, [](Game& game)
+	{
+		for (int32 x = 0; x < Game::gridSize.x; ++x)
+		{
+			game.tellGridBecomeEmpty({ x, Game::gridSize.y });
+		}
+		game.resolveCascade();
+		g_sink = g_sink + game.cascade.chainDepth;
+	});
+
+	bench("isGameOver/empty", EmptyBoard(), 1000, [](Game& game) { g_sink = g_sink + game.isGameOver(); });
+	bench("isGameOver/full_enemy_grid", FullEnemyBoard(), 1000, [](Game& game) { g_sink = g_sink + game.isGameOver(); });
+
+	bench("getMixedColor/all_pairs", EmptyBoard(), 1000, [](Game&)
+	{
+		for (int32 a = 0; a <= static_cast<int32>(ColorType::black); ++a)
+		{
+			for (int32 b = 0; b <= static_cast<int32>(ColorType::black); ++b)
+			{
+				if (auto mixed = getMixedColor(ColorType(a), ColorType(b)))
+				{
+					g_sink = g_sink + static_cast<int32>(*mixed);
+				}
+			}
+		}
+	});
+
+	bench("spawnEnemies/one_row", EmptyBoard(), 100, [](Game& game)
+	{
+		--game.enemySetIndexY;
+		game.spawnEnemies();
+	});
+
+	// 盤面の大きさごとの snapshot() + restore() と、比較用の Game のコピー
+	// スナップショットのバッファは使い回すので、2 回目からは確保が起きない
+	const std::vector<std::pair<std::string, Game>> snapshotBoards = {
+		{ "empty", EmptyBoard() },
+		{ "lane_nodes_10", LaneNodesBoard(10) },
+		{ "lane_nodes_50", LaneNodesBoard(50) },
+		{ "lane_nodes_200", LaneNodesBoard(200) },
+		{ "full_enemy_grid", FullEnemyBoard() },
+	};
+
+	GameSnapshot snapshot;
+
+	for (const auto& [boardName, board] : snapshotBoards)
+	{
+		bench("snapshot+restore/" + boardName, board, 100, [&](Game& game)
+		{
+			game.snapshot(snapshot);
+			game.restore(snapshot);
+			g_sink = g_sink + static_cast<int64_t>(snapshot.bytes.size());
+		});
+		bench("copy/" + boardName, board, 100, [](Game& game)
+		{
+			Game copy = game;
+			g_sink = g_sink + copy.score;
+		});
+	}
+
+	if (not WriteJSON(jsonPath, results))
+	{
+		std::fprintf(stderr, "failed to write %s\n", jsonPath);
+		return 1;
+	}
+}
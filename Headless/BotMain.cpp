@@ -0,0 +1,141 @@
+# include <algorithm>
+# include <chrono>
+# include <cstdio>
+# include <cstdlib>
+# include <cstring>
+# include <thread>
+# include <vector>
+# include "Game.hpp"
+# include "SearchBot.hpp"
+# include "ThreadPool.hpp"
+
+// 探索するプレイヤーでゲームを回し、スコアとロールアウト/s を表示する
+//
+// ColorMixBot [--games N] [--seed S] [--threads T] [--rollouts R] [--horizon TICKS] [--max-ticks N] [--scaling]
+//
+// --scaling を付けると 1 スレッドから --threads まで倍々に増やして同じゲームを回し、速度の伸びを表示する
+namespace
+{
+	using namespace ColorMix;
+
+	struct BotRun
+	{
+		int32 score = 0;
+
+		long long ticks = 0;
+
+		long long rollouts = 0;
+
+		double seconds = 0.0;
+	};
+
+	BotRun RunGame(ThreadPool& pool, const SearchBotOptions& options, uint64 seed, long long maxTicks)
+	{
+		Game game{ seed };
+		SearchBotOptions botOptions = options;
+		botOptions.seed = seed;
+		SearchBot bot{ pool, botOptions };
+
+		BotRun run;
+		const auto start = std::chrono::steady_clock::now();
+
+		while ((not game.isGameOver()) and (run.ticks < maxTicks))
+		{
+			game.update(options.delta, bot.next(game));
+			++run.ticks;
+		}
+
+		run.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		run.score = game.score;
+		run.rollouts = bot.rollouts();
+		return run;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	int32 games = 1;
+	uint64 seed = 1;
+	size_t threads = std::max(1u, std::thread::hardware_concurrency());
+	long long maxTicks = 120LL * 60 * 5;
+	bool scaling = false;
+	SearchBotOptions options;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		const bool hasValue = (i + 1 < argc);
+
+		if (std::strcmp(argv[i], "--scaling") == 0)
+		{
+			scaling = true;
+		}
+		else if (hasValue and (std::strcmp(argv[i], "--games") == 0))
+		{
+			games = std::atoi(argv[++i]);
+		}
+		else if (hasValue and (std::strcmp(argv[i], "--seed") == 0))
+		{
+			seed = std::strtoull(argv[++i], nullptr, 10);
+		}
+		else if (hasValue and (std::strcmp(argv[i], "--threads") == 0))
+		{
+			threads = static_cast<size_t>(std::max(1, std::atoi(argv[++i])));
+		}
+		else if (hasValue and (std::strcmp(argv[i], "--rollouts") == 0))
+		{
+			options.rolloutsPerMove = std::atoi(argv[++i]);
+		}
+		else if (hasValue and (std::strcmp(argv[i], "--horizon") == 0))
+		{
+			options.horizonTicks = std::atoi(argv[++i]);
+		}
+		else if (hasValue and (std::strcmp(argv[i], "--max-ticks") == 0))
+		{
+			maxTicks = std::atoll(argv[++i]);
+		}
+		else
+		{
+			std::fprintf(stderr, "unknown option: %s\n", argv[i]);
+			return 1;
+		}
+	}
+
+	if (scaling)
+	{
+		std::vector<size_t> threadCounts;
+
+		for (size_t t = 1; t < threads; t *= 2)
+		{
+			threadCounts.push_back(t);
+		}
+
+		threadCounts.push_back(threads);
+
+		double baseline = 0.0;
+
+		for (size_t t : threadCounts)
+		{
+			ThreadPool pool{ t };
+			const BotRun run = RunGame(pool, options, seed, maxTicks);
+			const double rate = run.rollouts / run.seconds;
+			baseline = (t == 1) ? rate : baseline;
+			std::printf("threads=%zu score=%d ticks=%lld rollouts=%lld %.0f rollouts/s speedup=%.2fx\n", t, run.score, run.ticks, run.rollouts, rate, rate / baseline);
+		}
+
+		return 0;
+	}
+
+	ThreadPool pool{ threads };
+	long long totalRollouts = 0;
+	double totalSeconds = 0.0;
+
+	for (int32 i = 0; i < games; ++i)
+	{
+		const BotRun run = RunGame(pool, options, seed + i, maxTicks);
+		totalRollouts += run.rollouts;
+		totalSeconds += run.seconds;
+		std::printf("game %d: seed=%llu score=%d ticks=%lld rollouts=%lld (%.0f rollouts/s)\n", i, static_cast<unsigned long long>(seed + i), run.score, run.ticks, run.rollouts, run.rollouts / run.seconds);
+	}
+
+	std::printf("total: %lld rollouts in %.3fs on %zu threads (%.0f rollouts/s)\n", totalRollouts, totalSeconds, pool.threadCount(), totalRollouts / totalSeconds);
+}
@@ -0,0 +1,40 @@
+# pragma once
+# include "Game.hpp"
+# include "InputQueue.hpp"
+
+namespace ColorMix
+{
+	// 待機ノードを押し、同じ tick の間にランダムなレーンまで動かして離すプレイヤー
+	// フレームごとに 1 回ボタンとカーソルを見るだけでは押したことも離したことも落ちる速いフリックを、InputQueue に時刻付きで積む
+	class FlickPolicy
+	{
+	public:
+
+		explicit FlickPolicy(uint64 seed = 0)
+			: m_random{ seed } {}
+
+		// time から time + delta の間に起きるイベントを queue に積む
+		void push(const Game& game, double time, double delta, InputQueue& queue)
+		{
+			if ((not game.waitingNode) or game.pickingNode or (0 < --m_wait))
+			{
+				return;
+			}
+
+			const Vec2 target{ game.laneCenterX(m_random.range(0, Game::gridSize.x - 1)), Game::laneHeight };
+			const Vec2 middle{ (Game::pickWaitingPos.x + target.x) / 2, (Game::pickWaitingPos.y + target.y) / 2 };
+
+			queue.push({ PointerEventType::press, Game::pickWaitingPos, time + delta * 0.2 });
+			queue.push({ PointerEventType::move, middle, time + delta * 0.5 });
+			queue.push({ PointerEventType::release, target, time + delta * 0.8 });
+
+			m_wait = m_random.range(2, 60);
+		}
+
+	private:
+
+		GameRandom m_random;
+
+		int32 m_wait = 0;
+	};
+}
@@ -0,0 +1,76 @@
+# pragma once
+# include <limits>
+# include "Game.hpp"
+
+namespace ColorMix
+{
+	// 待機ノードを拾い、混ぜられるノードがあればそこへ、なければいちばん空いているレーンの一番下に落とすプレイヤー
+	class GreedyPolicy
+	{
+	public:
+
+		// 1 手ごとに待つ tick 数
+		explicit GreedyPolicy(int32 intervalTicks = 20)
+			: m_intervalTicks{ intervalTicks } {}
+
+		TickInput next(const Game& game)
+		{
+			TickInput input;
+
+			if (game.pickingNode)
+			{
+				input.cursor = m_drop;
+				input.released = true;
+			}
+			else if (game.waitingNode and (--m_wait <= 0))
+			{
+				m_drop = ChooseDrop(game, *game.waitingNode);
+				input.cursor = Game::pickWaitingPos;
+				input.pressed = true;
+				m_wait = m_intervalTicks;
+			}
+
+			return input;
+		}
+
+	private:
+
+		int32 m_intervalTicks;
+
+		int32 m_wait = 0;
+
+		Vec2 m_drop;
+
+		static Vec2 ChooseDrop(const Game& game, ColorType type)
+		{
+			for (int32 x = 0; x < Game::gridSize.x; ++x)
+			{
+				for (const auto& node : game.nodesLanes[x])
+				{
+					if (Game::Mixing::Get(node.type, type))
+					{
+						return { game.laneCenterX(x), node.y };
+					}
+				}
+			}
+
+			// 一番下に積み上がった行がいちばん上にあるレーン (空のレーンが最優先)
+			int32 bestLane = 0;
+			int32 bestRow = -1;
+
+			for (int32 x = 0; x < Game::gridSize.x; ++x)
+			{
+				const int32 lowest = game.board.lowestOccupied(x);
+				const int32 row = (lowest == -1) ? std::numeric_limits<int32>::max() : lowest;
+
+				if (bestRow < row)
+				{
+					bestLane = x;
+					bestRow = row;
+				}
+			}
+
+			return { game.laneCenterX(bestLane), Game::laneHeight };
+		}
+	};
+}
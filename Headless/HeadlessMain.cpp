@@ -0,0 +1,205 @@
+# include <algorithm>
+# include <cassert>
+# include <chrono>
+# include <cstdio>
+# include <cstdlib>
+# include <cstring>
+# include <string>
+# include "AllocationCounter.hpp"
+# include "FlickPolicy.hpp"
+# include "Game.hpp"
+# include "GameClock.hpp"
+# include "InputQueue.hpp"
+# include "Profiler.hpp"
+# include "RandomPolicy.hpp"
+# include "Replay.hpp"
+
+// ウィンドウなしでゲームを回し、スコアと tick/s を表示する
+//
+// ColorMixHeadless [--games N] [--seed S] [--dt SECONDS] [--max-ticks N] [--policy random|flick] [--record DIR] [--check-allocations WARMUP_TICKS]
+//
+// --policy flick は、押してから離すまでを 1 tick の間に収めたイベント列を InputQueue 経由で渡す
+// --record を付けると各ゲームを DIR/game_N.cmrp に記録する (ColorMixReplay で再生できる)
+// プロファイラを有効にしてビルドすると (Debug か -DCOLORMIX_PROFILE=ON)、1 tick を 1 フレームとしてフェーズごとの時間も表示する
+// --check-allocations を付けると、通算 WARMUP_TICKS tick 以降の update() 中のヒープ確保を数え、1 回でもあれば失敗する
+// Debug ビルドでは付けなくても DebugAllocationWarmupTicks から数え、確保した tick で assert に失敗する
+int main(int argc, char* argv[])
+{
+	using namespace ColorMix;
+
+	int32 games = 10;
+	uint64 seed = 1;
+	double delta = TickDelta;
+	long long maxTicks = 120LL * 60 * 30;
+	const char* recordDirectory = nullptr;
+	bool flick = false;
+# ifdef NDEBUG
+	long long allocationWarmupTicks = -1;
+# else
+	constexpr long long DebugAllocationWarmupTicks = 600;
+	long long allocationWarmupTicks = DebugAllocationWarmupTicks;
+# endif
+
+	for (int i = 1; i + 1 < argc; i += 2)
+	{
+		if (std::strcmp(argv[i], "--games") == 0)
+		{
+			games = std::atoi(argv[i + 1]);
+		}
+		else if (std::strcmp(argv[i], "--seed") == 0)
+		{
+			seed = std::strtoull(argv[i + 1], nullptr, 10);
+		}
+		else if (std::strcmp(argv[i], "--dt") == 0)
+		{
+			delta = std::atof(argv[i + 1]);
+		}
+		else if (std::strcmp(argv[i], "--max-ticks") == 0)
+		{
+			maxTicks = std::atoll(argv[i + 1]);
+		}
+		else if (std::strcmp(argv[i], "--policy") == 0)
+		{
+			flick = (std::strcmp(argv[i + 1], "flick") == 0);
+		}
+		else if (std::strcmp(argv[i], "--record") == 0)
+		{
+			recordDirectory = argv[i + 1];
+		}
+		else if (std::strcmp(argv[i], "--check-allocations") == 0)
+		{
+			allocationWarmupTicks = std::atoll(argv[i + 1]);
+		}
+		else
+		{
+			std::fprintf(stderr, "unknown option: %s\n", argv[i]);
+			return 1;
+		}
+	}
+
+	Game game;
+	long long totalTicks = 0;
+	size_t steadyAllocations = 0;
+	long long allocatingTicks = 0;
+
+	// update() だけを数える。記録や方策の確保は含めない
+	const auto update = [&](double delta, const TickInput& input)
+	{
+		const bool counting = (0 <= allocationWarmupTicks) and (allocationWarmupTicks <= totalTicks);
+
+		if (counting)
+		{
+			AllocationCounter::start();
+		}
+
+		game.update(delta, input);
+
+		if (counting)
+		{
+			if (const size_t allocations = AllocationCounter::stop())
+			{
+				steadyAllocations += allocations;
+				++allocatingTicks;
+				assert((allocations == 0) and "BasicGame::update() allocated after warm-up");
+			}
+		}
+	};
+
+	InputQueue queue;
+	std::vector<TickInput> tickInputs;
+
+	const auto start = std::chrono::steady_clock::now();
+
+	for (int32 i = 0; i < games; ++i)
+	{
+		game.init(seed + i);
+		RandomPolicy policy{ seed + i };
+		FlickPolicy flickPolicy{ seed + i };
+		Replay replay;
+		replay.seed = seed + i;
+		queue.clear();
+		double queueTime = 0.0;
+
+		// 記録するときは、丸めた値で進めておけば再生したときに同じ結果になる
+		const auto step = [&](double delta, const TickInput& input)
+		{
+			if (recordDirectory)
+			{
+				const ReplayFrame& frame = replay.record(delta, input);
+				update(frame.delta, frame.input);
+			}
+			else
+			{
+				update(delta, input);
+			}
+		};
+
+		long long ticks = 0;
+		int32 maxChain = 0;
+		while ((not game.isGameOver()) and (ticks < maxTicks))
+		{
+			if (flick)
+			{
+				flickPolicy.push(game, queueTime, delta, queue);
+				queueTime += delta;
+
+				tickInputs.clear();
+				queue.drain(queueTime, tickInputs);
+
+				for (size_t k = 0; (k < tickInputs.size()) and (not game.isGameOver()); ++k)
+				{
+					step((k == 0) ? delta : 0.0, tickInputs[k]);
+				}
+			}
+			else
+			{
+				step(delta, policy.next(game));
+			}
+			maxChain = std::max(maxChain, game.cascade.chainDepth);
+			++ticks;
+			++totalTicks;
+
+		# if COLORMIX_PROFILE
+			Profiler::Current().setEntityCounts(CountEntities(game));
+			Profiler::Current().endFrame();
+		# endif
+		}
+
+		if (recordDirectory)
+		{
+			replay.finish(game);
+			const std::string path = std::string{ recordDirectory } + "/game_" + std::to_string(i) + ".cmrp";
+
+			if (not replay.save(path))
+			{
+				std::fprintf(stderr, "failed to write %s\n", path.c_str());
+				return 1;
+			}
+		}
+
+		std::printf("game %d: seed=%llu score=%d ticks=%lld time=%.1fs chain=%d\n", i, static_cast<unsigned long long>(seed + i), game.score, ticks, game.time, maxChain);
+	}
+
+	const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	std::printf("total: %lld ticks in %.3fs (%.0f ticks/s)\n", totalTicks, seconds, totalTicks / seconds);
+
+# if COLORMIX_PROFILE
+	std::printf("phase (us/tick, last %zu ticks)  p50      p99      max\n", Profiler::Current().frameCount());
+
+	for (size_t p = 0; p < ProfilePhaseCount; ++p)
+	{
+		const ProfileStats stats = Profiler::Current().stats(ProfilePhase(p));
+		std::printf("  %-30s %8.2f %8.2f %8.2f\n", ProfilePhaseName(ProfilePhase(p)), stats.p50, stats.p99, stats.max);
+	}
+# endif
+
+	if (0 <= allocationWarmupTicks)
+	{
+		std::printf("allocations after %lld warmup ticks: %zu in %lld ticks\n", allocationWarmupTicks, steadyAllocations, allocatingTicks);
+
+		if (steadyAllocations)
+		{
+			return 1;
+		}
+	}
+}
@@ -0,0 +1,570 @@
+# include <algorithm>
+# include <cstdint>
+# include <cstdio>
+# include <cstdlib>
+# include <cstring>
+# include <filesystem>
+# include <fstream>
+# include <iterator>
+# include <regex>
+# include <set>
+# include <string>
+# include <vector>
+
+// Web 版に preload するファイル (asset/, resources/) から、実際に使うものだけを小さくして書き出す
+//
+// ColorMixPackage [--source DIR] [--out DIR] [--backend essl|wgsl] [--audio auto|wav|ogg] [--ogg-quality Q] [--dry-run]
+//
+// - asset/ と resources/shader/ は、ソース (*.cpp, *.hpp) の文字列リテラルに出てくるものだけを残す
+// - resources/engine/ は Siv3D が起動時に読むので、使わないバックエンドのシェーダとサウンドフォントだけを除く
+// - WAV は fmt と data 以外のチャンク (埋め込みのタグや画像) を、PNG は表示に関わらないチャンクを取り除く (どちらも無劣化)
+// - --audio ogg では oggenc か ffmpeg で Ogg Vorbis にする。Siv3D は拡張子ではなく中身で形式を判定するので、パスはそのまま
+//   小さくならなかったものは WAV のまま残す
+// - 既定の --audio auto はエンコーダがあれば ogg、なければ wav (メタデータを除くだけ) にして、そのことをサイズの表のあとに警告する
+//
+// Linux でもネットワークなしで動く。Release|Emscripten は書き出した package/ があればそれを preload する (なければ asset/ と resources/ をそのまま)
+// 書き出す前に out を消すので、このツールが前に書き出したもの (MarkerName がある) 以外の既存のディレクトリには書き出さない
+namespace
+{
+	namespace fs = std::filesystem;
+
+	using Bytes = std::vector<unsigned char>;
+
+	enum class AudioMode
+	{
+		// エンコーダがあれば ogg、なければ wav
+		automatic,
+
+		wav,
+
+		ogg,
+	};
+
+	struct Options
+	{
+		fs::path source = "ColorMix Web";
+
+		// 空なら source/package
+		fs::path out;
+
+		std::string backend = "essl";
+
+		AudioMode audio = AudioMode::automatic;
+
+		std::string oggQuality = "4";
+
+		bool dryRun = false;
+	};
+
+	// out がこのツールで書き出したものだという目印。vcxproj もこれを見て package/ を使うか決める
+	constexpr const char* MarkerName = ".colormix-package";
+
+	struct Entry
+	{
+		// source からの相対パス
+		std::string path;
+
+		std::uintmax_t sourceSize = 0;
+
+		// 書き出さないものは 0
+		std::uintmax_t packagedSize = 0;
+
+		std::string action;
+	};
+
+	bool ReadFile(const fs::path& path, Bytes& bytes)
+	{
+		std::ifstream file{ path, std::ios::binary };
+
+		if (not file)
+		{
+			return false;
+		}
+
+		bytes.assign(std::istreambuf_iterator<char>{ file }, std::istreambuf_iterator<char>{});
+		return true;
+	}
+
+	bool WriteFile(const fs::path& path, const Bytes& bytes)
+	{
+		fs::create_directories(path.parent_path());
+		std::ofstream file{ path, std::ios::binary };
+		file.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+		return static_cast<bool>(file);
+	}
+
+	std::uint32_t ReadLE32(const unsigned char* p)
+	{
+		return (p[0] | (p[1] << 8) | (p[2] << 16) | (std::uint32_t(p[3]) << 24));
+	}
+
+	std::uint32_t ReadBE32(const unsigned char* p)
+	{
+		return ((std::uint32_t(p[0]) << 24) | (p[1] << 16) | (p[2] << 8) | p[3]);
+	}
+
+	void WriteLE32(unsigned char* p, std::uint32_t value)
+	{
+		for (int i = 0; i < 4; ++i)
+		{
+			p[i] = static_cast<unsigned char>(value >> (8 * i));
+		}
+	}
+
+	// RIFF WAVE から fmt と data だけを残す。形が違うときは false
+	bool StripWave(const Bytes& in, Bytes& out)
+	{
+		if ((in.size() < 12) or (std::memcmp(in.data(), "RIFF", 4) != 0) or (std::memcmp(in.data() + 8, "WAVE", 4) != 0))
+		{
+			return false;
+		}
+
+		out.assign(in.begin(), in.begin() + 12);
+		bool hasFormat = false, hasData = false;
+
+		for (size_t i = 12; i + 8 <= in.size();)
+		{
+			const std::uint32_t size = ReadLE32(in.data() + i + 4);
+			const size_t end = i + 8 + size;
+
+			if (in.size() < end)
+			{
+				return false;
+			}
+
+			const bool isFormat = (std::memcmp(in.data() + i, "fmt ", 4) == 0);
+			const bool isData = (std::memcmp(in.data() + i, "data", 4) == 0);
+
+			if (isFormat or isData)
+			{
+				out.insert(out.end(), in.begin() + i, in.begin() + end);
+
+				// 奇数長のチャンクの後ろには埋め草が 1 バイト入る
+				if (size & 1)
+				{
+					out.push_back(0);
+				}
+
+				hasFormat |= isFormat;
+				hasData |= isData;
+			}
+
+			i = end + (size & 1);
+		}
+
+		WriteLE32(out.data() + 4, static_cast<std::uint32_t>(out.size() - 8));
+		return (hasFormat and hasData);
+	}
+
+	// PNG から、描画に関わらない補助チャンク (pHYs, eXIf, tEXt など) を取り除く
+	bool StripPNG(const Bytes& in, Bytes& out)
+	{
+		constexpr unsigned char Signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+
+		if ((in.size() < 8) or (std::memcmp(in.data(), Signature, 8) != 0))
+		{
+			return false;
+		}
+
+		// 大文字で始まる必須チャンクと、色や透明度に関わる補助チャンクは残す
+		constexpr const char* Kept[] = { "tRNS", "gAMA", "cHRM", "sRGB", "iCCP", "sBIT" };
+		out.assign(in.begin(), in.begin() + 8);
+
+		for (size_t i = 8; i + 12 <= in.size();)
+		{
+			const size_t next = i + 12 + ReadBE32(in.data() + i);
+
+			if (in.size() < next)
+			{
+				return false;
+			}
+
+			const char* type = reinterpret_cast<const char*>(in.data() + i + 4);
+			const bool critical = ('A' <= type[0]) and (type[0] <= 'Z');
+
+			if (critical or std::any_of(std::begin(Kept), std::end(Kept), [&](const char* kept) { return (std::memcmp(type, kept, 4) == 0); }))
+			{
+				out.insert(out.end(), in.begin() + i, in.begin() + next);
+			}
+
+			i = next;
+		}
+
+		return true;
+	}
+
+	bool HasCommand(const char* command)
+	{
+		const std::string line = std::string{ "command -v " } + command + " > /dev/null 2>&1";
+		return (std::system(line.c_str()) == 0);
+	}
+
+	std::string Quote(const fs::path& path)
+	{
+		std::string quoted = "'";
+
+		for (char c : path.string())
+		{
+			quoted += (c == '\'') ? std::string{ "'\\''" } : std::string(1, c);
+		}
+
+		return quoted + "'";
+	}
+
+	// 外部のエンコーダで Ogg Vorbis にする。使えるものがなければ空
+	std::string FindOggEncoder()
+	{
+		for (const char* encoder : { "oggenc", "ffmpeg" })
+		{
+			if (HasCommand(encoder))
+			{
+				return encoder;
+			}
+		}
+
+		return{};
+	}
+
+	bool EncodeOgg(const std::string& encoder, const std::string& quality, const fs::path& in, const fs::path& out)
+	{
+		const std::string line = (encoder == "oggenc")
+			? ("oggenc --quiet -q " + quality + " -o " + Quote(out) + " " + Quote(in))
+			: ("ffmpeg -nostdin -loglevel error -y -i " + Quote(in) + " -c:a libvorbis -q:a " + quality + " -f ogg " + Quote(out));
+		return (std::system(line.c_str()) == 0);
+	}
+
+	// ソースの文字列リテラルに出てくる asset/ と resources/ のパス
+	std::set<std::string> ScanReferences(const fs::path& source)
+	{
+		const std::regex literal{ R"re("((?:asset|resources)/[^"\\]+)")re" };
+		std::set<std::string> references;
+
+		for (const fs::directory_entry& entry : fs::directory_iterator{ source })
+		{
+			const fs::path extension = entry.path().extension();
+
+			if ((extension != ".cpp") and (extension != ".hpp"))
+			{
+				continue;
+			}
+
+			std::ifstream file{ entry.path() };
+			const std::string text{ std::istreambuf_iterator<char>{ file }, std::istreambuf_iterator<char>{} };
+
+			for (auto it = std::sregex_iterator{ text.begin(), text.end(), literal }; it != std::sregex_iterator{}; ++it)
+			{
+				references.insert((*it)[1].str());
+			}
+		}
+
+		return references;
+	}
+
+	bool StartsWith(const std::string& text, const std::string& prefix)
+	{
+		return (text.compare(0, prefix.size(), prefix) == 0);
+	}
+
+	// 残さないときはその理由を返す
+	std::string DropReason(const std::string& path, const std::set<std::string>& references, const std::string& backend)
+	{
+		if (StartsWith(path, "resources/engine/"))
+		{
+			if (StartsWith(path, "resources/engine/soundfont/"))
+			{
+				return "drop (MIDI unused)";
+			}
+
+			if (StartsWith(path, "resources/engine/shader/") and (not StartsWith(path, "resources/engine/shader/" + backend + "/")))
+			{
+				return "drop (other backend)";
+			}
+
+			return{};
+		}
+
+		if (references.contains(path))
+		{
+			return (StartsWith(path, "resources/shader/") and (not StartsWith(path, "resources/shader/" + backend + "/")))
+				? "drop (other backend)" : "";
+		}
+
+		return "drop (unreferenced)";
+	}
+
+	// path が base そのものか、その中にあるか
+	bool IsWithin(const fs::path& path, const fs::path& base)
+	{
+		const fs::path relative = fs::weakly_canonical(path).lexically_relative(fs::weakly_canonical(base));
+		return ((not relative.empty()) and (*relative.begin() != ".."));
+	}
+
+	// out に書き出してよいか。だめなら理由を返す
+	const char* CheckOutput(const Options& options)
+	{
+		if (IsWithin(options.source, options.out))
+		{
+			return "out must not be the source or contain it";
+		}
+
+		for (const char* root : { "asset", "resources" })
+		{
+			if (IsWithin(options.out, options.source / root))
+			{
+				return "out must not be inside the preloaded directories";
+			}
+		}
+
+		if (fs::exists(options.out) and (not fs::exists(options.out / MarkerName)))
+		{
+			return "out already exists and was not written by ColorMixPackage";
+		}
+
+		return nullptr;
+	}
+
+	std::string FormatSize(std::uintmax_t bytes)
+	{
+		char buffer[32];
+		std::snprintf(buffer, sizeof(buffer), "%.1f KB", bytes / 1024.0);
+		return buffer;
+	}
+
+	bool ParseOptions(int argc, char* argv[], Options& options)
+	{
+		for (int i = 1; i < argc; ++i)
+		{
+			const bool hasValue = (i + 1 < argc);
+
+			if (std::strcmp(argv[i], "--dry-run") == 0)
+			{
+				options.dryRun = true;
+			}
+			else if ((std::strcmp(argv[i], "--source") == 0) and hasValue)
+			{
+				options.source = argv[++i];
+			}
+			else if ((std::strcmp(argv[i], "--out") == 0) and hasValue)
+			{
+				options.out = argv[++i];
+			}
+			else if ((std::strcmp(argv[i], "--backend") == 0) and hasValue)
+			{
+				options.backend = argv[++i];
+			}
+			else if ((std::strcmp(argv[i], "--audio") == 0) and hasValue)
+			{
+				const char* mode = argv[++i];
+
+				if (std::strcmp(mode, "auto") == 0)
+				{
+					options.audio = AudioMode::automatic;
+				}
+				else if (std::strcmp(mode, "wav") == 0)
+				{
+					options.audio = AudioMode::wav;
+				}
+				else if (std::strcmp(mode, "ogg") == 0)
+				{
+					options.audio = AudioMode::ogg;
+				}
+				else
+				{
+					return false;
+				}
+			}
+			else if ((std::strcmp(argv[i], "--ogg-quality") == 0) and hasValue)
+			{
+				options.oggQuality = argv[++i];
+			}
+			else
+			{
+				return false;
+			}
+		}
+
+		if (options.out.empty())
+		{
+			options.out = options.source / "package";
+		}
+
+		return ((options.backend == "essl") or (options.backend == "wgsl"));
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	Options options;
+
+	if (not ParseOptions(argc, argv, options))
+	{
+		std::fprintf(stderr, "usage: ColorMixPackage [--source DIR] [--out DIR] [--backend essl|wgsl] [--audio auto|wav|ogg] [--ogg-quality Q] [--dry-run]\n");
+		return 1;
+	}
+
+	if (const char* reason = CheckOutput(options))
+	{
+		std::fprintf(stderr, "%s: %s\n", options.out.string().c_str(), reason);
+		return 1;
+	}
+
+	const std::set<std::string> references = ScanReferences(options.source);
+	bool ok = true;
+
+	// 参照しているのに無いファイルは、ビルドしてから気付くより先に止める
+	for (const std::string& reference : references)
+	{
+		if (not fs::is_regular_file(options.source / reference))
+		{
+			std::fprintf(stderr, "missing: %s\n", reference.c_str());
+			ok = false;
+		}
+	}
+
+	if (not ok)
+	{
+		return 1;
+	}
+
+	std::string oggEncoder;
+	bool noEncoder = false;
+
+	if (options.audio != AudioMode::wav)
+	{
+		oggEncoder = FindOggEncoder();
+
+		if (oggEncoder.empty() and (options.audio == AudioMode::ogg))
+		{
+			std::fprintf(stderr, "--audio ogg needs oggenc or ffmpeg in PATH\n");
+			return 1;
+		}
+
+		noEncoder = oggEncoder.empty();
+		options.audio = noEncoder ? AudioMode::wav : AudioMode::ogg;
+	}
+
+	std::vector<std::string> paths;
+
+	for (const char* root : { "asset", "resources" })
+	{
+		if (not fs::is_directory(options.source / root))
+		{
+			continue;
+		}
+
+		for (const fs::directory_entry& entry : fs::recursive_directory_iterator{ options.source / root })
+		{
+			if (entry.is_regular_file())
+			{
+				paths.push_back(entry.path().lexically_relative(options.source).generic_string());
+			}
+		}
+	}
+
+	std::sort(paths.begin(), paths.end());
+
+	if (not options.dryRun)
+	{
+		fs::remove_all(options.out);
+
+		// 途中で失敗しても次の実行で消せるよう、最初に目印を置く
+		if (not WriteFile(options.out / MarkerName, {}))
+		{
+			std::fprintf(stderr, "cannot write: %s\n", (options.out / MarkerName).string().c_str());
+			return 1;
+		}
+	}
+
+	std::vector<Entry> entries;
+
+	for (const std::string& path : paths)
+	{
+		const fs::path sourcePath = options.source / path;
+		const fs::path outPath = options.out / path;
+
+		Entry entry;
+		entry.path = path;
+		entry.sourceSize = fs::file_size(sourcePath);
+		entry.action = DropReason(path, references, options.backend);
+
+		if (not entry.action.empty())
+		{
+			entries.push_back(entry);
+			continue;
+		}
+
+		Bytes bytes, packed;
+
+		if (not ReadFile(sourcePath, bytes))
+		{
+			std::fprintf(stderr, "cannot read: %s\n", sourcePath.string().c_str());
+			return 1;
+		}
+
+		const fs::path extension = sourcePath.extension();
+
+		if ((extension == ".wav") and StripWave(bytes, packed))
+		{
+			bytes.swap(packed);
+			entry.action = "strip metadata";
+
+			if (options.audio == AudioMode::ogg)
+			{
+				const fs::path stripped = fs::temp_directory_path() / "ColorMixPackage.wav";
+				const fs::path encoded = fs::temp_directory_path() / "ColorMixPackage.ogg";
+
+				if (WriteFile(stripped, bytes) and EncodeOgg(oggEncoder, options.oggQuality, stripped, encoded)
+					and ReadFile(encoded, packed) and (packed.size() < bytes.size()))
+				{
+					bytes.swap(packed);
+					entry.action = "ogg vorbis q" + options.oggQuality;
+				}
+
+				fs::remove(stripped);
+				fs::remove(encoded);
+			}
+		}
+		else if ((extension == ".png") and StripPNG(bytes, packed))
+		{
+			entry.action = (packed.size() < bytes.size()) ? "strip metadata" : "copy";
+			bytes.swap(packed);
+		}
+		else
+		{
+			entry.action = "copy";
+		}
+
+		if ((not options.dryRun) and (not WriteFile(outPath, bytes)))
+		{
+			std::fprintf(stderr, "cannot write: %s\n", outPath.string().c_str());
+			return 1;
+		}
+
+		entry.packagedSize = bytes.size();
+		entries.push_back(entry);
+	}
+
+	std::uintmax_t sourceTotal = 0, packagedTotal = 0;
+	std::printf("%-72s %10s %10s  %s\n", "file", "source", "package", "action");
+
+	for (const Entry& entry : entries)
+	{
+		std::printf("%-72s %10s %10s  %s\n", entry.path.c_str(), FormatSize(entry.sourceSize).c_str(),
+			(entry.packagedSize ? FormatSize(entry.packagedSize).c_str() : "-"), entry.action.c_str());
+		sourceTotal += entry.sourceSize;
+		packagedTotal += entry.packagedSize;
+	}
+
+	std::printf("%-72s %10s %10s  %.1f%% smaller\n", "total", FormatSize(sourceTotal).c_str(), FormatSize(packagedTotal).c_str(),
+		(sourceTotal ? 100.0 * (1.0 - double(packagedTotal) / sourceTotal) : 0.0));
+
+	if (noEncoder)
+	{
+		std::printf("warning: neither oggenc nor ffmpeg is in PATH, so WAV files were only stripped (install one to encode them as Ogg Vorbis)\n");
+	}
+
+	if (not options.dryRun)
+	{
+		std::printf("written to %s\n", options.out.string().c_str());
+	}
+}
@@ -0,0 +1,42 @@
+# pragma once
+# include "Game.hpp"
+
+namespace ColorMix
+{
+	// 待機ノードを拾って、ランダムなレーンの一番下に落とすだけのプレイヤー
+	class RandomPolicy
+	{
+	public:
+
+		explicit RandomPolicy(uint64 seed = 0)
+			: m_random{ seed } {}
+
+		TickInput next(const Game& game)
+		{
+			TickInput input;
+
+			if (game.pickingNode)
+			{
+				input.cursor = { game.laneCenterX(m_targetLane), Game::laneHeight };
+				input.released = true;
+			}
+			else if (game.waitingNode and (--m_wait <= 0))
+			{
+				input.cursor = Game::pickWaitingPos;
+				input.pressed = true;
+				m_targetLane = m_random.range(0, Game::gridSize.x - 1);
+				m_wait = m_random.range(2, 60);
+			}
+
+			return input;
+		}
+
+	private:
+
+		GameRandom m_random;
+
+		int32 m_targetLane = 0;
+
+		int32 m_wait = 0;
+	};
+}
@@ -0,0 +1,73 @@
+# include <chrono>
+# include <cstdio>
+# include <cstdlib>
+# include <cstring>
+# include <string>
+# include <vector>
+# include "Replay.hpp"
+
+// 記録したゲームを描画なしで最大速度で再生し、記録時と同じ結果になるか確かめる
+//
+// ColorMixReplay [--repeat N] FILE...
+//
+// --repeat で同じリプレイを何度も流すと、実際のプレイを負荷として計測できる
+int main(int argc, char* argv[])
+{
+	using namespace ColorMix;
+
+	int32 repeat = 1;
+	std::vector<std::string> paths;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		if ((std::strcmp(argv[i], "--repeat") == 0) and (i + 1 < argc))
+		{
+			repeat = std::atoi(argv[++i]);
+		}
+		else
+		{
+			paths.push_back(argv[i]);
+		}
+	}
+
+	if (paths.empty())
+	{
+		std::fprintf(stderr, "usage: ColorMixReplay [--repeat N] FILE...\n");
+		return 1;
+	}
+
+	Game game;
+	long long totalTicks = 0;
+	bool allMatch = true;
+
+	const auto start = std::chrono::steady_clock::now();
+
+	for (const auto& path : paths)
+	{
+		const auto replay = Replay::Load(path);
+
+		if (not replay)
+		{
+			std::fprintf(stderr, "%s: failed to load\n", path.c_str());
+			allMatch = false;
+			continue;
+		}
+
+		ReplayResult result;
+
+		for (int32 i = 0; i < repeat; ++i)
+		{
+			result = Play(*replay, game);
+			totalTicks += result.ticks;
+		}
+
+		allMatch = allMatch and result.matches;
+		std::printf("%s: seed=%llu score=%d ticks=%lld hash=%016llx %s\n", path.c_str(), static_cast<unsigned long long>(replay->seed),
+			result.score, result.ticks, static_cast<unsigned long long>(result.hash), result.matches ? "ok" : "MISMATCH");
+	}
+
+	const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	std::printf("total: %lld ticks in %.3fs (%.0f ticks/s)\n", totalTicks, seconds, totalTicks / seconds);
+
+	return allMatch ? 0 : 1;
+}
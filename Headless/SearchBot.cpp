@@ -0,0 +1,188 @@
+# include <algorithm>
+# include "RandomPolicy.hpp"
+# include "SearchBot.hpp"
+
+namespace ColorMix
+{
+	namespace
+	{
+		// 盤面の一番下に積み上がった行までの余裕 (行数)。小さいほどゲームオーバーに近い
+		double Margin(const Game& game)
+		{
+			double margin = Game::gridSize.y;
+
+			for (int32 x = 0; x < Game::gridSize.x; ++x)
+			{
+				const int32 y = game.board.lowestOccupied(x);
+
+				if (y != -1)
+				{
+					margin = std::min(margin, (Game::laneHeight + Game::enemySpanLength / 2 - game.fixedNodeCenterYReal(y)) / Game::enemySpanLength);
+				}
+			}
+
+			return margin;
+		}
+
+		uint64 MixSeed(uint64 a, uint64 b)
+		{
+			GameRandom random{ a * 0x9E3779B97F4A7C15ULL + b };
+			return random.next();
+		}
+	}
+
+	SearchBot::SearchBot(ThreadPool& pool, const SearchBotOptions& options)
+		: m_pool{ pool }
+		, m_options{ options } {}
+
+	TickInput SearchBot::next(const Game& game)
+	{
+		TickInput input;
+
+		if (game.pickingNode)
+		{
+			input.cursor = m_pendingDrop.value_or(Vec2{ game.laneCenterX(0), Game::laneHeight });
+			input.released = true;
+			m_pendingDrop.reset();
+			return input;
+		}
+
+		if (0 < m_wait--)
+		{
+			return input;
+		}
+
+		const std::vector<BotMove> moves = candidates(game);
+
+		if (moves.empty())
+		{
+			return input;
+		}
+
+		const size_t rollouts = static_cast<size_t>(m_options.rolloutsPerMove);
+		std::vector<double> values(moves.size() * rollouts);
+		const uint64 decisionSeed = MixSeed(m_options.seed, m_decision++);
+
+		m_pool.parallelFor(values.size(), [&](size_t i)
+		{
+			values[i] = evaluate(game, moves[i / rollouts], MixSeed(decisionSeed, i));
+		});
+
+		m_rollouts += static_cast<long long>(values.size());
+
+		size_t best = 0;
+		double bestValue = 0.0;
+
+		for (size_t m = 0; m < moves.size(); ++m)
+		{
+			double sum = 0.0;
+
+			for (size_t r = 0; r < rollouts; ++r)
+			{
+				sum += values[m * rollouts + r];
+			}
+
+			if ((m == 0) or (bestValue < sum))
+			{
+				best = m;
+				bestValue = sum;
+			}
+		}
+
+		input.cursor = moves[best].pick;
+		input.pressed = true;
+		m_pendingDrop = moves[best].drop;
+		m_wait = m_options.thinkIntervalTicks;
+		return input;
+	}
+
+	std::vector<BotMove> SearchBot::candidates(const Game& game) const
+	{
+		// 拾えるもの: 待機ノードと各レーンのノード
+		struct Source
+		{
+			Vec2 pos;
+
+			ColorType type;
+
+			// 待機ノードは -1
+			int32 lane = -1;
+		};
+
+		std::vector<Source> sources;
+
+		if (game.waitingNode)
+		{
+			sources.push_back({ Game::pickWaitingPos, *game.waitingNode });
+		}
+
+		for (int32 x = 0; x < Game::gridSize.x; ++x)
+		{
+			for (const auto& node : game.nodesLanes[x])
+			{
+				sources.push_back({ Vec2{ game.laneCenterX(x), node.y }, node.type, x });
+			}
+		}
+
+		std::vector<BotMove> moves;
+
+		for (const auto& source : sources)
+		{
+			for (int32 x = 0; x < Game::gridSize.x; ++x)
+			{
+				moves.push_back({ source.pos, Vec2{ game.laneCenterX(x), Game::laneHeight } });
+
+				for (const auto& node : game.nodesLanes[x])
+				{
+					// 拾ったノード自身とは混ぜない。上限に詰まったノードは同じ y に並ぶので、レーンも比べる
+					const bool isSource = ((x == source.lane) and (node.y == source.pos.y));
+
+					if ((not isSource) and Game::Mixing::Get(node.type, source.type))
+					{
+						moves.push_back({ source.pos, Vec2{ game.laneCenterX(x), node.y } });
+					}
+				}
+			}
+
+			if (m_options.maxCandidates <= static_cast<int32>(moves.size()))
+			{
+				break;
+			}
+		}
+
+		moves.resize(std::min(moves.size(), static_cast<size_t>(m_options.maxCandidates)));
+		return moves;
+	}
+
+	double SearchBot::evaluate(const Game& game, const BotMove& move, uint64 seed) const
+	{
+		// スレッドごとに 1 つを使い回し、代入で確保済みの領域に書き込む
+		thread_local Game rollout;
+		rollout = game;
+		const int32 startScore = rollout.score;
+
+		TickInput input;
+		input.cursor = move.pick;
+		input.pressed = true;
+		rollout.update(m_options.delta, input);
+
+		input = {};
+		input.cursor = move.drop;
+		input.released = true;
+		rollout.update(m_options.delta, input);
+
+		RandomPolicy policy{ seed };
+
+		for (int32 i = 0; (i < m_options.horizonTicks) and (not rollout.isGameOver()); ++i)
+		{
+			rollout.update(m_options.delta, policy.next(rollout));
+		}
+
+		if (rollout.isGameOver())
+		{
+			return -1000.0;
+		}
+
+		return (rollout.score - startScore) * 10.0 + Margin(rollout);
+	}
+}
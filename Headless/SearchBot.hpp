@@ -0,0 +1,74 @@
+# pragma once
+# include <optional>
+# include <vector>
+# include "Game.hpp"
+# include "GameClock.hpp"
+# include "ThreadPool.hpp"
+
+namespace ColorMix
+{
+	// 1 手: pick でノードを拾い、次の tick に drop で離す (盤面ローカル座標)
+	// drop が混色できるノードの近くなら混ぜ、そうでなければレーンに落とす
+	struct BotMove
+	{
+		Vec2 pick;
+
+		Vec2 drop;
+	};
+
+	struct SearchBotOptions
+	{
+		// 候補 1 手あたりのロールアウト回数
+		int32 rolloutsPerMove = 8;
+
+		// ロールアウトで先読みする tick 数 (3 秒)
+		int32 horizonTicks = 360;
+
+		// 手を打ったあと次の手を考えるまで待つ tick 数
+		int32 thinkIntervalTicks = 40;
+
+		// 1 回に比べる候補の上限
+		int32 maxCandidates = 24;
+
+		double delta = TickDelta;
+
+		uint64 seed = 1;
+	};
+
+	// モンテカルロ法のプレイヤー
+	// 候補の手ごとに、打ったあとを RandomPolicy で horizonTicks だけ進めるロールアウトを並列に回し、平均がいちばん良い手を選ぶ
+	// ロールアウトの seed は (手番, 候補, 回数) だけで決まるので、スレッド数によらず同じ手を選ぶ
+	class SearchBot
+	{
+	public:
+
+		SearchBot(ThreadPool& pool, const SearchBotOptions& options = {});
+
+		TickInput next(const Game& game);
+
+		// これまでに回したロールアウトの数
+		long long rollouts() const
+		{
+			return m_rollouts;
+		}
+
+	private:
+
+		ThreadPool& m_pool;
+
+		SearchBotOptions m_options;
+
+		// 拾ったあと、次の tick で離す位置
+		std::optional<Vec2> m_pendingDrop;
+
+		int32 m_wait = 0;
+
+		uint64 m_decision = 0;
+
+		long long m_rollouts = 0;
+
+		std::vector<BotMove> candidates(const Game& game) const;
+
+		double evaluate(const Game& game, const BotMove& move, uint64 seed) const;
+	};
+}
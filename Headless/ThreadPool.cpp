@@ -0,0 +1,151 @@
+# include <algorithm>
+# include "ThreadPool.hpp"
+
+namespace ColorMix
+{
+	ThreadPool::ThreadPool(size_t threadCount)
+	{
+		threadCount = std::max<size_t>(threadCount, 1);
+
+		for (size_t i = 0; i < threadCount; ++i)
+		{
+			m_queues.push_back(std::make_unique<Queue>());
+		}
+
+		// 最後のキューは parallelFor() を呼んだスレッドのもの
+		for (size_t i = 0; i + 1 < threadCount; ++i)
+		{
+			m_threads.emplace_back([this, i] { workerLoop(i); });
+		}
+	}
+
+	ThreadPool::~ThreadPool()
+	{
+		{
+			std::lock_guard lock{ m_sleepMutex };
+			m_stop = true;
+		}
+
+		m_wake.notify_all();
+
+		for (auto& thread : m_threads)
+		{
+			thread.join();
+		}
+	}
+
+	void ThreadPool::parallelFor(size_t count, const std::function<void(size_t)>& body)
+	{
+		if (count == 0)
+		{
+			return;
+		}
+
+		m_body = &body;
+		m_remaining = count;
+
+		// 盗み合いで均せるよう、スレッド数より細かく分けて順に配る
+		const size_t chunk = std::max<size_t>(1, count / (threadCount() * 4));
+		size_t pushed = 0;
+
+		for (size_t begin = 0, i = 0; begin < count; begin += chunk, ++i)
+		{
+			Queue& queue = *m_queues[i % threadCount()];
+			std::lock_guard lock{ queue.mutex };
+			queue.ranges.push_back({ begin, std::min(begin + chunk, count) });
+			++pushed;
+		}
+
+		{
+			std::lock_guard lock{ m_sleepMutex };
+			m_queued += pushed;
+		}
+
+		m_wake.notify_all();
+
+		const size_t self = threadCount() - 1;
+		Range range;
+
+		while (tryPop(self, range) or trySteal(self, range))
+		{
+			run(range);
+		}
+
+		std::unique_lock lock{ m_sleepMutex };
+		m_done.wait(lock, [this] { return m_remaining == 0; });
+		m_body = nullptr;
+	}
+
+	void ThreadPool::workerLoop(size_t self)
+	{
+		for (;;)
+		{
+			Range range;
+
+			if (tryPop(self, range) or trySteal(self, range))
+			{
+				run(range);
+				continue;
+			}
+
+			std::unique_lock lock{ m_sleepMutex };
+			m_wake.wait(lock, [this] { return m_stop or (0 < m_queued); });
+
+			if (m_stop)
+			{
+				return;
+			}
+		}
+	}
+
+	bool ThreadPool::tryPop(size_t self, Range& range)
+	{
+		Queue& queue = *m_queues[self];
+		std::lock_guard lock{ queue.mutex };
+
+		if (queue.ranges.empty())
+		{
+			return false;
+		}
+
+		range = queue.ranges.back();
+		queue.ranges.pop_back();
+		--m_queued;
+		return true;
+	}
+
+	bool ThreadPool::trySteal(size_t self, Range& range)
+	{
+		for (size_t i = 1; i < threadCount(); ++i)
+		{
+			Queue& queue = *m_queues[(self + i) % threadCount()];
+			std::lock_guard lock{ queue.mutex };
+
+			if (not queue.ranges.empty())
+			{
+				range = queue.ranges.front();
+				queue.ranges.pop_front();
+				--m_queued;
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	void ThreadPool::run(const Range& range)
+	{
+		for (size_t i = range.begin; i < range.end; ++i)
+		{
+			(*m_body)(i);
+		}
+
+		const size_t size = (range.end - range.begin);
+
+		if (m_remaining.fetch_sub(size) == size)
+		{
+			std::lock_guard lock{ m_sleepMutex };
+			m_done.notify_all();
+		}
+	}
+}
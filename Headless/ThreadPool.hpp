@@ -0,0 +1,82 @@
+# pragma once
+# include <atomic>
+# include <condition_variable>
+# include <cstddef>
+# include <deque>
+# include <functional>
+# include <memory>
+# include <mutex>
+# include <thread>
+# include <vector>
+
+namespace ColorMix
+{
+	// ワークスティーリングのスレッドプール
+	// 各ワーカーは自分のキューの後ろから仕事を取り、空なら他のワーカーのキューの前から盗む
+	// parallelFor() を呼んだスレッドもワーカーの 1 つとして働く
+	class ThreadPool
+	{
+	public:
+
+		// threadCount は呼び出し側のスレッドも含めた数
+		explicit ThreadPool(size_t threadCount = std::thread::hardware_concurrency());
+
+		~ThreadPool();
+
+		ThreadPool(const ThreadPool&) = delete;
+
+		ThreadPool& operator=(const ThreadPool&) = delete;
+
+		size_t threadCount() const
+		{
+			return m_queues.size();
+		}
+
+		// body(0) ... body(count - 1) を分けて実行し、すべて終わるまで待つ
+		void parallelFor(size_t count, const std::function<void(size_t)>& body);
+
+	private:
+
+		struct Range
+		{
+			size_t begin = 0;
+
+			size_t end = 0;
+		};
+
+		struct Queue
+		{
+			std::mutex mutex;
+
+			std::deque<Range> ranges;
+		};
+
+		std::vector<std::unique_ptr<Queue>> m_queues;
+
+		std::vector<std::thread> m_threads;
+
+		const std::function<void(size_t)>* m_body = nullptr;
+
+		// キューに残っている Range の数
+		std::atomic<size_t> m_queued{ 0 };
+
+		// まだ終わっていない添え字の数
+		std::atomic<size_t> m_remaining{ 0 };
+
+		std::mutex m_sleepMutex;
+
+		std::condition_variable m_wake;
+
+		std::condition_variable m_done;
+
+		bool m_stop = false;
+
+		void workerLoop(size_t self);
+
+		bool tryPop(size_t self, Range& range);
+
+		bool trySteal(size_t self, Range& range);
+
+		void run(const Range& range);
+	};
+}
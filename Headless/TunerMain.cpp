@@ -0,0 +1,359 @@
+# include <algorithm>
+# include <chrono>
+# include <cstdio>
+# include <cstdlib>
+# include <cstring>
+# include <string>
+# include <thread>
+# include <vector>
+# include "Game.hpp"
+# include "GameClock.hpp"
+# include "GreedyPolicy.hpp"
+# include "RandomPolicy.hpp"
+# include "ThreadPool.hpp"
+
+// 難しさのパラメータを総当たりで変えながら、シード付きのゲームを並列にたくさん回して生存時間とスコアの分布を表示する
+//
+// ColorMixTuner [--games N] [--seed S] [--threads T] [--max-ticks N] [--policy random|greedy] [--csv PATH]
+//               [--first-speed A,B,...] [--ramp A,B,...] [--node-speed A,B,...] [--node-set rybryb,...] [--waves uniform,balanced]
+//
+// --node-set は r y b o g p k (赤 黄 青 橙 緑 紫 黒) の並び
+// --waves は敵の行の並べ方 (WavePattern)
+// --csv を付けると 1 ゲーム 1 行で書き出す
+namespace
+{
+	using namespace ColorMix;
+
+	enum class PolicyType
+	{
+		random,
+		greedy,
+	};
+
+	struct GameResult
+	{
+		int32 score = 0;
+
+		long long ticks = 0;
+
+		// ゲームオーバーまでの時間 [秒]。max-ticks で打ち切ったときはそこまで
+		double survival = 0.0;
+
+		bool survived = false;
+	};
+
+	struct ParameterSet
+	{
+		Difficulty difficulty;
+
+		std::string nodeSetName;
+
+		std::string wavesName;
+	};
+
+	// カンマ区切りの数。数でないものや空の項目があれば false
+	bool ParseNumbers(const char* text, std::vector<double>& numbers)
+	{
+		numbers.clear();
+
+		for (const char* p = text;; ++p)
+		{
+			char* end = nullptr;
+			const double number = std::strtod(p, &end);
+
+			if ((end == p) or ((*end != ',') and (*end != '\0')))
+			{
+				return false;
+			}
+
+			numbers.push_back(number);
+			p = end;
+
+			if (*p == '\0')
+			{
+				return true;
+			}
+		}
+	}
+
+	bool ParseNodeSet(const std::string& name, std::vector<ColorType>& nodeSet)
+	{
+		constexpr char Letters[] = "rybogpk";
+		nodeSet.clear();
+
+		for (char c : name)
+		{
+			const char* found = std::strchr(Letters, c);
+
+			if ((not found) or (c == '\0'))
+			{
+				return false;
+			}
+
+			nodeSet.push_back(ColorType(found - Letters));
+		}
+
+		return (not nodeSet.empty());
+	}
+
+	bool ParseWavePattern(const std::string& name, WavePattern& pattern)
+	{
+		if (name == "uniform")
+		{
+			pattern = WavePattern::uniform;
+		}
+		else if (name == "balanced")
+		{
+			pattern = WavePattern::balanced;
+		}
+		else
+		{
+			return false;
+		}
+
+		return true;
+	}
+
+	std::vector<std::string> Split(const char* text)
+	{
+		std::vector<std::string> items{ "" };
+
+		for (const char* p = text; *p; ++p)
+		{
+			if (*p == ',')
+			{
+				items.emplace_back();
+			}
+			else
+			{
+				items.back().push_back(*p);
+			}
+		}
+
+		return items;
+	}
+
+	template <class Policy>
+	GameResult Simulate(Game& game, Policy policy, long long maxTicks)
+	{
+		GameResult result;
+
+		while ((not game.isGameOver()) and (result.ticks < maxTicks))
+		{
+			game.update(TickDelta, policy.next(game));
+			++result.ticks;
+		}
+
+		result.score = game.score;
+		result.survival = game.time;
+		result.survived = (not game.isGameOver());
+		return result;
+	}
+
+	double Percentile(const std::vector<double>& sorted, double p)
+	{
+		return sorted[std::min(sorted.size() - 1, static_cast<size_t>(p * (sorted.size() - 1) + 0.5))];
+	}
+
+	double Mean(const std::vector<double>& values)
+	{
+		double sum = 0.0;
+
+		for (double value : values)
+		{
+			sum += value;
+		}
+
+		return sum / values.size();
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	int32 games = 1000;
+	uint64 seed = 1;
+	size_t threads = std::max(1u, std::thread::hardware_concurrency());
+	long long maxTicks = 120LL * 60 * 10;
+	PolicyType policyType = PolicyType::random;
+	const char* csvPath = nullptr;
+
+	const Difficulty defaults;
+	std::vector<double> firstSpeeds{ defaults.firstEnemySpeed };
+	std::vector<double> ramps{ defaults.enemySpeedRamp };
+	std::vector<double> nodeSpeeds{ defaults.nodeSpeed };
+	std::vector<std::string> nodeSets{ "rybryb" };
+	std::vector<std::string> waves{ "uniform" };
+
+	for (int i = 1; i + 1 < argc; i += 2)
+	{
+		if (std::strcmp(argv[i], "--games") == 0)
+		{
+			games = std::max(1, std::atoi(argv[i + 1]));
+		}
+		else if (std::strcmp(argv[i], "--seed") == 0)
+		{
+			seed = std::strtoull(argv[i + 1], nullptr, 10);
+		}
+		else if (std::strcmp(argv[i], "--threads") == 0)
+		{
+			threads = static_cast<size_t>(std::max(1, std::atoi(argv[i + 1])));
+		}
+		else if (std::strcmp(argv[i], "--max-ticks") == 0)
+		{
+			maxTicks = std::atoll(argv[i + 1]);
+		}
+		else if (std::strcmp(argv[i], "--policy") == 0)
+		{
+			policyType = (std::strcmp(argv[i + 1], "greedy") == 0) ? PolicyType::greedy : PolicyType::random;
+		}
+		else if (std::strcmp(argv[i], "--csv") == 0)
+		{
+			csvPath = argv[i + 1];
+		}
+		else if (std::strcmp(argv[i], "--first-speed") == 0)
+		{
+			if (not ParseNumbers(argv[i + 1], firstSpeeds))
+			{
+				std::fprintf(stderr, "invalid number: %s\n", argv[i + 1]);
+				return 1;
+			}
+		}
+		else if (std::strcmp(argv[i], "--ramp") == 0)
+		{
+			if (not ParseNumbers(argv[i + 1], ramps))
+			{
+				std::fprintf(stderr, "invalid number: %s\n", argv[i + 1]);
+				return 1;
+			}
+		}
+		else if (std::strcmp(argv[i], "--node-speed") == 0)
+		{
+			if (not ParseNumbers(argv[i + 1], nodeSpeeds))
+			{
+				std::fprintf(stderr, "invalid number: %s\n", argv[i + 1]);
+				return 1;
+			}
+		}
+		else if (std::strcmp(argv[i], "--node-set") == 0)
+		{
+			nodeSets = Split(argv[i + 1]);
+		}
+		else if (std::strcmp(argv[i], "--waves") == 0)
+		{
+			waves = Split(argv[i + 1]);
+		}
+		else
+		{
+			std::fprintf(stderr, "unknown option: %s\n", argv[i]);
+			return 1;
+		}
+	}
+
+	std::vector<ParameterSet> parameterSets;
+
+	for (double firstSpeed : firstSpeeds)
+	{
+		for (double ramp : ramps)
+		{
+			for (double nodeSpeed : nodeSpeeds)
+			{
+				for (const auto& nodeSetName : nodeSets)
+				{
+					for (const auto& wavesName : waves)
+					{
+						ParameterSet set;
+						set.difficulty.firstEnemySpeed = firstSpeed;
+						set.difficulty.enemySpeedRamp = ramp;
+						set.difficulty.nodeSpeed = nodeSpeed;
+						set.nodeSetName = nodeSetName;
+						set.wavesName = wavesName;
+
+						if (not ParseNodeSet(nodeSetName, set.difficulty.nodeSet))
+						{
+							std::fprintf(stderr, "invalid node set: %s\n", nodeSetName.c_str());
+							return 1;
+						}
+
+						if (not ParseWavePattern(wavesName, set.difficulty.wavePattern))
+						{
+							std::fprintf(stderr, "invalid waves: %s\n", wavesName.c_str());
+							return 1;
+						}
+
+						parameterSets.push_back(set);
+					}
+				}
+			}
+		}
+	}
+
+	FILE* csv = csvPath ? std::fopen(csvPath, "w") : nullptr;
+
+	if (csvPath and (not csv))
+	{
+		std::fprintf(stderr, "failed to open %s\n", csvPath);
+		return 1;
+	}
+
+	if (csv)
+	{
+		std::fprintf(csv, "first_speed,ramp,node_speed,node_set,waves,seed,score,survival,ticks,survived\n");
+	}
+
+	ThreadPool pool{ threads };
+	std::vector<GameResult> results(games);
+
+	for (const auto& set : parameterSets)
+	{
+		const auto start = std::chrono::steady_clock::now();
+
+		pool.parallelFor(results.size(), [&](size_t i)
+		{
+			// ゲームはスレッドごとに 1 つを使い回す (確保済みの領域もそのまま)
+			thread_local Game game;
+			game.difficulty = set.difficulty;
+			game.init(seed + i);
+
+			results[i] = (policyType == PolicyType::greedy)
+				? Simulate(game, GreedyPolicy{}, maxTicks)
+				: Simulate(game, RandomPolicy{ seed + i }, maxTicks);
+		});
+
+		const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		std::vector<double> survivals, scores;
+		int32 survivedCount = 0;
+
+		for (const auto& result : results)
+		{
+			survivals.push_back(result.survival);
+			scores.push_back(result.score);
+			survivedCount += result.survived;
+		}
+
+		std::sort(survivals.begin(), survivals.end());
+		std::sort(scores.begin(), scores.end());
+
+		std::printf("first-speed=%g ramp=%g node-speed=%g node-set=%s waves=%s games=%d\n",
+			set.difficulty.firstEnemySpeed, set.difficulty.enemySpeedRamp, set.difficulty.nodeSpeed, set.nodeSetName.c_str(), set.wavesName.c_str(), games);
+		std::printf("  survival [s]: mean=%.1f p10=%.1f p50=%.1f p90=%.1f max=%.1f (survived %d)\n",
+			Mean(survivals), Percentile(survivals, 0.1), Percentile(survivals, 0.5), Percentile(survivals, 0.9), survivals.back(), survivedCount);
+		std::printf("  score:        mean=%.2f p10=%.0f p50=%.0f p90=%.0f max=%.0f\n",
+			Mean(scores), Percentile(scores, 0.1), Percentile(scores, 0.5), Percentile(scores, 0.9), scores.back());
+		std::printf("  %.0f games/s on %zu threads\n", games / seconds, pool.threadCount());
+
+		if (csv)
+		{
+			for (size_t i = 0; i < results.size(); ++i)
+			{
+				std::fprintf(csv, "%g,%g,%g,%s,%s,%llu,%d,%.3f,%lld,%d\n", set.difficulty.firstEnemySpeed, set.difficulty.enemySpeedRamp, set.difficulty.nodeSpeed,
+					set.nodeSetName.c_str(), set.wavesName.c_str(), static_cast<unsigned long long>(seed + i), results[i].score, results[i].survival, results[i].ticks, results[i].survived ? 1 : 0);
+			}
+		}
+	}
+
+	if (csv)
+	{
+		std::fclose(csv);
+	}
+}
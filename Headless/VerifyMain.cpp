@@ -0,0 +1,265 @@
+# include <algorithm>
+# include <chrono>
+# include <cstdio>
+# include <cstdlib>
+# include <cstring>
+# include <filesystem>
+# include <string>
+# include <thread>
+# include <vector>
+# include "Replay.hpp"
+# include "ThreadPool.hpp"
+
+// 投稿されたリプレイをまとめて描画なしで並列に再生し、申告されたスコアが本当か確かめる
+//
+// ColorMixVerify [--threads T] [--max-ticks N] [--csv PATH] DIR
+//
+// DIR は投稿先の代わりのディレクトリで、中の *.cmrp (1 投稿 1 ファイル) をすべて確かめる
+// 申告されたスコアはリプレイに記録された finalScore。ColorMix::Verify() で流し、Web 版が記録しえない frame がなく、
+// 再生したスコアと最後の StateHash() が記録と一致すれば ok
+// --max-ticks は刻みの数の上限で、それより長いリプレイは再生せずに弾く (既定は 120 Hz で 1 時間)。frame の数は 1 刻みあたり InputQueue::MaxInputsPerTick 個まで
+// --csv を付けると 1 リプレイ 1 行で判定を書き出す
+namespace
+{
+	using namespace ColorMix;
+
+	enum class Verdict
+	{
+		ok,
+
+		// 再生したスコアが申告と違う
+		scoreMismatch,
+
+		// スコアは合っているが最後の状態が違う (入力の改ざんか、再現できない記録)
+		hashMismatch,
+
+		// 以下は ReplayViolation と同じ
+		invalidDelta,
+
+		tooManyInputs,
+
+		inputAfterGameOver,
+
+		unfinished,
+
+		tooLong,
+
+		unreadable,
+	};
+
+	const char* VerdictName(Verdict verdict)
+	{
+		switch (verdict)
+		{
+		case Verdict::ok:
+			return "ok";
+		case Verdict::scoreMismatch:
+			return "score-mismatch";
+		case Verdict::hashMismatch:
+			return "hash-mismatch";
+		case Verdict::invalidDelta:
+			return "invalid-delta";
+		case Verdict::tooManyInputs:
+			return "too-many-inputs";
+		case Verdict::inputAfterGameOver:
+			return "input-after-game-over";
+		case Verdict::unfinished:
+			return "unfinished";
+		case Verdict::tooLong:
+			return "too-long";
+		default:
+			return "unreadable";
+		}
+	}
+
+	struct Submission
+	{
+		std::string path;
+
+		Verdict verdict = Verdict::unreadable;
+
+		uint64 seed = 0;
+
+		int32 claimedScore = 0;
+
+		int32 score = 0;
+
+		// 記録された frame の数
+		long long ticks = 0;
+
+		// 実際に流した frame の数
+		long long simulatedTicks = 0;
+	};
+
+	Submission VerifyFile(const std::string& path, long long maxTicks, Game& game)
+	{
+		Submission submission;
+		submission.path = path;
+
+		const auto replay = Replay::Load(path);
+
+		if (not replay)
+		{
+			return submission;
+		}
+
+		submission.seed = replay->seed;
+		submission.claimedScore = replay->finalScore;
+		submission.ticks = static_cast<long long>(replay->frames.size());
+
+		const ReplayResult result = Verify(*replay, game, maxTicks);
+		submission.score = result.score;
+		submission.simulatedTicks = result.ticks;
+
+		if (result.violation == ReplayViolation::invalidDelta)
+		{
+			submission.verdict = Verdict::invalidDelta;
+		}
+		else if (result.violation == ReplayViolation::tooManyInputs)
+		{
+			submission.verdict = Verdict::tooManyInputs;
+		}
+		else if (result.violation == ReplayViolation::inputAfterGameOver)
+		{
+			submission.verdict = Verdict::inputAfterGameOver;
+		}
+		else if (result.violation == ReplayViolation::unfinished)
+		{
+			submission.verdict = Verdict::unfinished;
+		}
+		else if (result.violation == ReplayViolation::tooLong)
+		{
+			submission.verdict = Verdict::tooLong;
+		}
+		else if (result.score != replay->finalScore)
+		{
+			submission.verdict = Verdict::scoreMismatch;
+		}
+		else if (result.hash != replay->finalHash)
+		{
+			submission.verdict = Verdict::hashMismatch;
+		}
+		else
+		{
+			submission.verdict = Verdict::ok;
+		}
+
+		return submission;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	size_t threads = std::max(1u, std::thread::hardware_concurrency());
+	long long maxTicks = 120LL * 60 * 60;
+	const char* csvPath = nullptr;
+	const char* directory = nullptr;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		if ((std::strcmp(argv[i], "--threads") == 0) and (i + 1 < argc))
+		{
+			threads = static_cast<size_t>(std::max(1, std::atoi(argv[++i])));
+		}
+		else if ((std::strcmp(argv[i], "--max-ticks") == 0) and (i + 1 < argc))
+		{
+			maxTicks = std::atoll(argv[++i]);
+		}
+		else if ((std::strcmp(argv[i], "--csv") == 0) and (i + 1 < argc))
+		{
+			csvPath = argv[++i];
+		}
+		else if ((argv[i][0] != '-') and (not directory))
+		{
+			directory = argv[i];
+		}
+		else
+		{
+			std::fprintf(stderr, "unknown option: %s\n", argv[i]);
+			return 1;
+		}
+	}
+
+	if (not directory)
+	{
+		std::fprintf(stderr, "usage: ColorMixVerify [--threads T] [--max-ticks N] [--csv PATH] DIR\n");
+		return 1;
+	}
+
+	std::vector<std::string> paths;
+	std::error_code error;
+
+	for (const auto& entry : std::filesystem::directory_iterator{ directory, error })
+	{
+		if (entry.is_regular_file() and (entry.path().extension() == ".cmrp"))
+		{
+			paths.push_back(entry.path().string());
+		}
+	}
+
+	if (error)
+	{
+		std::fprintf(stderr, "%s: %s\n", directory, error.message().c_str());
+		return 1;
+	}
+
+	// 判定の並びを実行ごとに変えないよう名前順にする
+	std::sort(paths.begin(), paths.end());
+
+	FILE* csv = csvPath ? std::fopen(csvPath, "w") : nullptr;
+
+	if (csvPath and (not csv))
+	{
+		std::fprintf(stderr, "failed to open %s\n", csvPath);
+		return 1;
+	}
+
+	ThreadPool pool{ threads };
+	std::vector<Submission> submissions(paths.size());
+
+	const auto start = std::chrono::steady_clock::now();
+
+	pool.parallelFor(paths.size(), [&](size_t i)
+	{
+		// ゲームはスレッドごとに 1 つを使い回す (確保済みの領域もそのまま)
+		thread_local Game game;
+		submissions[i] = VerifyFile(paths[i], maxTicks, game);
+	});
+
+	const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	if (csv)
+	{
+		std::fprintf(csv, "path,verdict,seed,claimed_score,score,ticks\n");
+	}
+
+	long long totalTicks = 0;
+	size_t okCount = 0;
+
+	for (const auto& submission : submissions)
+	{
+		totalTicks += submission.simulatedTicks;
+		okCount += (submission.verdict == Verdict::ok);
+
+		std::printf("%s: %s seed=%llu claimed=%d score=%d ticks=%lld\n", submission.path.c_str(), VerdictName(submission.verdict),
+			static_cast<unsigned long long>(submission.seed), submission.claimedScore, submission.score, submission.ticks);
+
+		if (csv)
+		{
+			std::fprintf(csv, "%s,%s,%llu,%d,%d,%lld\n", submission.path.c_str(), VerdictName(submission.verdict),
+				static_cast<unsigned long long>(submission.seed), submission.claimedScore, submission.score, submission.ticks);
+		}
+	}
+
+	if (csv)
+	{
+		std::fclose(csv);
+	}
+
+	const double replaysPerSecond = submissions.size() / seconds;
+	std::printf("total: %zu replays (%zu ok, %zu rejected), %lld ticks simulated in %.3fs\n", submissions.size(), okCount, submissions.size() - okCount, totalTicks, seconds);
+	std::printf("  %.0f replays/s on %zu threads (%.0f replays/s per core, %.0f ticks/s)\n",
+		replaysPerSecond, pool.threadCount(), replaysPerSecond / pool.threadCount(), totalTicks / seconds);
+
+	return (okCount == submissions.size()) ? 0 : 1;
+}
@@ -0,0 +1,114 @@
+# include <cstdio>
+# include <vector>
+# include "Game.hpp"
+# include "GameClock.hpp"
+# include "InputQueue.hpp"
+# include "RandomPolicy.hpp"
+# include "Replay.hpp"
+
+// ColorMix::Verify() が改ざんしたリプレイを弾くことを確かめる (ctest から呼ぶ)
+//
+// 改ざんしたものは Play() で流し直して finalScore と finalHash を付け直してあり、スコアとハッシュの比較だけでは見抜けない
+namespace
+{
+	using namespace ColorMix;
+
+	int g_failures = 0;
+
+	void Check(bool condition, const char* name)
+	{
+		std::printf("%s: %s\n", name, condition ? "ok" : "FAILED");
+		g_failures += (not condition);
+	}
+
+	// RandomPolicy で Web 版と同じ刻みで進めて記録する。maxTicks 刻みで打ち切る
+	Replay Record(uint64 seed, long long maxTicks)
+	{
+		Game game;
+		game.init(seed);
+		RandomPolicy policy{ seed };
+		Replay replay;
+		replay.seed = seed;
+
+		for (long long ticks = 0; (not game.isGameOver()) and (ticks < maxTicks); ++ticks)
+		{
+			const ReplayFrame& frame = replay.record(TickDelta, policy.next(game));
+			game.update(frame.delta, frame.input);
+		}
+
+		replay.finish(game);
+		return replay;
+	}
+
+	// 改ざんしたあと、スコアとハッシュを付け直す
+	Replay Refinish(Replay replay)
+	{
+		Game game;
+		Play(replay, game);
+		replay.finish(game);
+		return replay;
+	}
+
+	ReplayViolation Violation(const Replay& replay, long long maxTicks)
+	{
+		Game game;
+		return Verify(replay, game, maxTicks).violation;
+	}
+}
+
+int main()
+{
+	constexpr long long MaxTicks = 120LL * 60 * 60;
+
+	const Replay honest = *Replay::Deserialize(Record(3, MaxTicks).serialize());
+	Game game;
+	Check(Verify(honest, game, MaxTicks).matches, "honest replay");
+	Check(Verify(Record(3, 600), game, 600).matches, "honest replay cut at the cap");
+
+	Replay negative = honest;
+	negative.frames[60].delta = -TickDelta;
+	Check(Violation(Refinish(negative), MaxTicks) == ReplayViolation::invalidDelta, "negative delta");
+
+	Replay oversized = honest;
+	oversized.frames[60].delta = 0.5;
+	Check(Violation(Refinish(oversized), MaxTicks) == ReplayViolation::invalidDelta, "oversized delta");
+
+	Replay slowed = honest;
+	slowed.frames[60].delta = Replay::Quantize(TickDelta / 2, {}).delta;
+	Check(Violation(Refinish(slowed), MaxTicks) == ReplayViolation::invalidDelta, "slowed delta");
+
+	// ゲームオーバーのあとに入力を続ける
+	Replay afterGameOver = honest;
+	TickInput click;
+	click.cursor = Game::pickWaitingPos;
+	click.pressed = true;
+
+	for (int32 i = 0; i < 196'000; ++i)
+	{
+		afterGameOver.record(TickDelta, click);
+	}
+
+	Check(Violation(Refinish(afterGameOver), MaxTicks) == ReplayViolation::inputAfterGameOver, "input after game over");
+
+	// 1 つの刻みに操作を詰め込む (delta が 0 の frame はゲームの時間を進めずに何度でも拾って置ける)
+	Replay stacked = honest;
+	const ReplayFrame held = stacked.frames[60];
+	std::vector<ReplayFrame> extra(InputQueue::MaxInputsPerTick, held);
+
+	for (auto& frame : extra)
+	{
+		frame.delta = 0.0;
+	}
+
+	stacked.frames.insert(stacked.frames.begin() + 61, extra.begin(), extra.end());
+	Check(Violation(Refinish(stacked), MaxTicks) == ReplayViolation::tooManyInputs, "actions stacked into one tick");
+
+	// ゲームオーバーの前で切る
+	Replay truncated = honest;
+	truncated.frames.resize(truncated.frames.size() / 2);
+	Check(Violation(Refinish(truncated), MaxTicks) == ReplayViolation::unfinished, "unfinished");
+
+	Check(Violation(honest, 100) == ReplayViolation::tooLong, "too long");
+
+	return (g_failures == 0) ? 0 : 1;
+}